@@ -0,0 +1,232 @@
+/* Registry and the common run / report path shared by every benchmark kernel.
+ *
+ *Author: Grayson Kern
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "bench.h"
+
+static const benchKernel *registry[BENCH_MAX_KERNELS];
+static int numKernels = 0;
+static pthread_once_t builtinOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t registryLock = PTHREAD_MUTEX_INITIALIZER;
+
+static int add_kernel(const benchKernel *kernel)
+{
+	int i, r = -1;
+
+	pthread_mutex_lock(&registryLock);
+
+	for(i = 0; i < numKernels; i++)
+	{
+		if(strcmp(registry[i] -> suite, kernel -> suite) == 0 && strcmp(registry[i] -> name, kernel -> name) == 0)
+			break; // Names are unique within a suite.
+	}
+
+	if(i == numKernels && numKernels < BENCH_MAX_KERNELS)
+	{
+		registry[numKernels++] = kernel;
+		r = 0;
+	}
+
+	pthread_mutex_unlock(&registryLock);
+	return r;
+}
+
+static void register_builtin(void)
+{
+	const benchKernel *k;
+
+	for(k = cpuKernels; k -> name != NULL; k++)
+		add_kernel(k);
+
+	for(k = netKernels; k -> name != NULL; k++)
+		add_kernel(k);
+}
+
+int bench_register(const benchKernel *kernel)
+{
+	pthread_once(&builtinOnce, register_builtin);
+
+	if(kernel == NULL || kernel -> suite == NULL || kernel -> name == NULL || kernel -> run == NULL)
+		return -1;
+
+	return add_kernel(kernel);
+}
+
+const benchKernel *bench_find(const char *suite, const char *name)
+{
+	const benchKernel *found = NULL;
+	int i;
+
+	pthread_once(&builtinOnce, register_builtin);
+	pthread_mutex_lock(&registryLock);
+
+	for(i = 0; i < numKernels && found == NULL; i++)
+	{
+		if((suite == NULL || strcmp(registry[i] -> suite, suite) == 0) && strcmp(registry[i] -> name, name) == 0)
+			found = registry[i];
+	}
+
+	pthread_mutex_unlock(&registryLock);
+	return found;
+}
+
+int bench_count(void)
+{
+	int count;
+
+	pthread_once(&builtinOnce, register_builtin);
+	pthread_mutex_lock(&registryLock);
+	count = numKernels;
+	pthread_mutex_unlock(&registryLock);
+	return count;
+}
+
+const benchKernel *bench_get(int index)
+{
+	const benchKernel *kernel;
+
+	pthread_once(&builtinOnce, register_builtin);
+	pthread_mutex_lock(&registryLock);
+	kernel = (index >= 0 && index < numKernels) ? registry[index] : NULL;
+	pthread_mutex_unlock(&registryLock);
+	return kernel;
+}
+
+int bench_run(const benchKernel *kernel, const benchParams *params, benchResult *result)
+{
+	int r;
+
+	memset(result, 0, sizeof(benchResult));
+
+	if(params -> threads < 1)
+		return BENCH_EUSAGE;
+
+	r = kernel -> run(params, result);
+
+	if(r != BENCH_OK)
+		return r;
+
+	if(result -> elapsed < 0)
+		return bench_fail(result, "error in elapsed time, check for proper timing; exiting...");
+
+	if(result -> elapsed == 0)
+		return bench_fail(result, "elapsed time is 0, check for proper timing or make sure to increase amount of work performed; exiting...");
+
+	result -> throughput = result -> gigaOps / result -> elapsed;
+	result -> gops = result -> ops / 1000000000.0 / result -> elapsed;
+	return BENCH_OK;
+}
+
+void bench_report(FILE *out, const benchKernel *kernel, const benchParams *params, const benchResult *result)
+{
+	int i;
+
+	int net = strcmp(kernel -> suite, "net") == 0; // netio reports its metrics first, then ops/sec.
+
+	if(!net)
+		fprintf(out, "mode=%s type=%s size=%lld threads=%d time=%lf throughput=%lf gops=%lf\n",kernel -> name,params -> type,params -> size,params -> threads,result -> elapsed,result -> throughput,result -> gops);
+
+	for(i = 0; i < result -> numMetrics; i++)
+	{
+		fprintf(out, "%s%s=", i ? " " : "", result -> metrics[i].name);
+		fprintf(out, result -> metrics[i].format, result -> metrics[i].value);
+	}
+
+	if(result -> numMetrics > 0)
+		fprintf(out, "\n");
+
+	if(net)
+		fprintf(out, "==> %f ops/sec\n",result -> ops/result -> elapsed);
+}
+
+void bench_usage(FILE *out, const char *suite)
+{
+	int i;
+
+	pthread_once(&builtinOnce, register_builtin);
+	pthread_mutex_lock(&registryLock);
+
+	for(i = 0; i < numKernels; i++)
+	{
+		if(strcmp(registry[i] -> suite, suite) == 0)
+		{
+			fprintf(out, "     - %s: %s \n", registry[i] -> name, registry[i] -> types);
+
+			if(registry[i] -> options != NULL)
+				fprintf(out, "         [%s] \n", registry[i] -> options);
+		}
+	}
+
+	pthread_mutex_unlock(&registryLock);
+}
+
+void bench_metric(benchResult *result, const char *name, const char *format, double value)
+{
+	if(result -> numMetrics < BENCH_MAX_METRICS)
+	{
+		result -> metrics[result -> numMetrics].name = name;
+		result -> metrics[result -> numMetrics].format = format;
+		result -> metrics[result -> numMetrics].value = value;
+		result -> numMetrics++;
+	}
+}
+
+void bench_row_metric(benchRow *row, const char *name, const char *format, double value)
+{
+	if(row -> numMetrics < BENCH_MAX_ROW_METRICS)
+	{
+		row -> metrics[row -> numMetrics].name = name;
+		row -> metrics[row -> numMetrics].format = format;
+		row -> metrics[row -> numMetrics].value = value;
+		row -> numMetrics++;
+	}
+}
+
+// Hands a finished row to the caller's callback, if there is one.
+void bench_emit_row(const benchParams *params, const benchRow *row)
+{
+	if(params -> onRow != NULL)
+		params -> onRow(row, params -> rowContext);
+}
+
+int bench_fail(benchResult *result, const char *message)
+{
+	snprintf(result -> error, sizeof(result -> error), "%s", message);
+	return BENCH_EFAIL;
+}
+
+// Starts numThreads threads on fn, thread i getting args + i * argSize, and joins them.
+int bench_threads(void *(*fn)(void *), void *args, size_t argSize, int numThreads, benchResult *result)
+{
+	pthread_t threads[numThreads];
+	int i, r = BENCH_OK;
+
+	for(i = 0; i < numThreads; i++)
+	{
+		if(pthread_create(&threads[i], NULL, fn, (char *) args + i * argSize))
+		{
+			r = bench_fail(result, "Error: unable to create one or more threads");
+			break;
+		}
+	}
+
+	numThreads = i;
+
+	for(i = 0; i < numThreads; i++)
+	{
+		if(pthread_join(threads[i], NULL))
+			r = bench_fail(result, "Error: unable to join one or more threads");
+	}
+
+	return r;
+}
+
+double bench_seconds(const struct timeval *start, const struct timeval *end)
+{
+	return (((end -> tv_sec * 1000000 + end -> tv_usec) - (start -> tv_sec * 1000000 + start -> tv_usec)))/1000000.0;
+}
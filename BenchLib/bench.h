@@ -0,0 +1,109 @@
+/* Embeddable benchmark library: the cpubench and netio kernels behind a registry of named benchmarks.
+ * Every kernel is run through the same interface, it fills in a benchResult with its timing, the work done
+ * and any kernel specific metrics, and bench_run / bench_report turn that into throughput figures.
+ * cpubench and netio are thin command line front ends over this, other programs can link it and run
+ * the same measurements in process.
+ *
+ *Author: Grayson Kern
+ *
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <sys/time.h>
+
+#define BENCH_MAX_KERNELS 64
+#define BENCH_MAX_METRICS 32
+#define BENCH_MAX_OPTIONS 3
+#define BENCH_MAX_ROW_METRICS 8
+
+#define BENCH_OK 0
+#define BENCH_EUSAGE -1 // Unknown type or bad options, the caller should show its usage.
+#define BENCH_EFAIL -2 // The run itself failed, see benchResult.error.
+
+typedef struct benchMetric // Kernel specific figure, name and format are string literals.
+{
+	const char *name;
+	const char *format; // printf conversion for value, e.g. "%lf", "%.0f" or "%e".
+	double value;
+
+}benchMetric;
+
+typedef struct benchRow // One point of a sweep or matrix (sync rows, cores pairs).
+{
+	const char *label; // What the row measures, e.g. the sync primitive, NULL if nothing.
+	int numMetrics;
+	benchMetric metrics[BENCH_MAX_ROW_METRICS];
+
+}benchRow;
+
+typedef void (*benchRowFn)(const benchRow *row, void *context);
+
+typedef struct benchParams // What to run, as given on the command line of the tools.
+{
+	const char *type; // cpubench type, netio operation.
+	unsigned long long size; // cpubench size, netio num_ops.
+	int threads;
+	const char *options[BENCH_MAX_OPTIONS]; // Optional trailing arguments (cutoff, density, batch, ...), NULL when absent.
+	FILE *out; // Where sweeps and matrices print their rows, NULL to keep quiet.
+	benchRowFn onRow; // Called with every row as it is measured, NULL if not wanted.
+	void *rowContext;
+
+}benchParams;
+
+typedef struct benchResult
+{
+	double elapsed; // Seconds spent in the timed region.
+	double gigaOps; // Work in the units of the tool's throughput figure.
+	double ops; // Operations actually performed (a multiply-add counts as two).
+	double throughput; // gigaOps / elapsed, filled in by bench_run.
+	double gops; // ops / 1e9 / elapsed, filled in by bench_run.
+	int numMetrics;
+	benchMetric metrics[BENCH_MAX_METRICS];
+	char error[128];
+
+}benchResult;
+
+typedef int (*benchRunFn)(const benchParams *params, benchResult *result);
+
+typedef struct benchKernel
+{
+	const char *suite; // "cpu" (cpubench modes) or "net" (netio methods).
+	const char *name;
+	const char *types; // Accepted types / operations, for usage text.
+	const char *options; // Meaning of the optional arguments, for usage text.
+	benchRunFn run;
+
+}benchKernel;
+
+// Registry. The built in kernels are registered on first use, bench_register adds more.
+int bench_register(const benchKernel *kernel);
+const benchKernel *bench_find(const char *suite, const char *name);
+int bench_count(void);
+const benchKernel *bench_get(int index);
+
+// Runs a kernel and derives throughput and gops, returns BENCH_OK or one of the errors above.
+int bench_run(const benchKernel *kernel, const benchParams *params, benchResult *result);
+
+// Prints the result as the tools do: for cpu kernels one line of headline figures, then the metrics if there
+// are any; for net kernels the metrics, then netio's ops/sec line.
+void bench_report(FILE *out, const benchKernel *kernel, const benchParams *params, const benchResult *result);
+
+// Prints one usage line per registered kernel of a suite.
+void bench_usage(FILE *out, const char *suite);
+
+// Helpers for kernels.
+void bench_metric(benchResult *result, const char *name, const char *format, double value);
+void bench_row_metric(benchRow *row, const char *name, const char *format, double value);
+void bench_emit_row(const benchParams *params, const benchRow *row);
+int bench_fail(benchResult *result, const char *message);
+int bench_threads(void *(*fn)(void *), void *args, size_t argSize, int numThreads, benchResult *result);
+double bench_seconds(const struct timeval *start, const struct timeval *end);
+
+// Built in kernel tables, registered by the registry itself.
+extern const benchKernel cpuKernels[];
+extern const benchKernel netKernels[];
+
+#endif
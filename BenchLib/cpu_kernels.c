@@ -0,0 +1,2298 @@
+/* cpubench kernels: flops, dense, recursive, Strassen, out-of-core and sparse matrix multiplies
+ * and synchronization primitive contention, each exposed through a run function in cpuKernels.
+ *
+ *Author: Grayson Kern
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "bench.h"
+
+#define GIGAFLOPS 1000000000
+#define GIGABYTES 1024*1024*1024
+#define DEFAULT_CUTOFF 64
+#define DEFAULT_TILE 512
+#define DEFAULT_DENSITY 0.01
+#define SPMM_COLS 16
+#define SYNC_PRIMITIVES 6
+
+typedef struct multArgsD // Struct for double matrices.
+{
+	double **mat1;
+	double **mat2;
+	double **res;
+	int threadID, numThreads, size;
+
+}multArgsD;
+
+typedef struct multArgsI // Struct for integer matrices.
+{
+	int **mat1;
+	int **mat2;
+	int **res;
+	int threadID, numThreads, size;
+
+}multArgsI;
+
+typedef struct multArgsR // Struct for reduced and mixed precision matrices (flat, second one transposed).
+{
+	const void *mat1;
+	const void *mat2T;
+	void *res;
+	int threadID, numThreads, size;
+
+}multArgsR;
+
+typedef struct flopArgs // Struct for flops.
+{
+	int size, numThreads, threadID, intResult;
+	float floatResult;
+	double doubleResult;
+	FILE *out; // Where the result is printed, NULL to skip it.
+
+}flopArgs;
+
+typedef struct recArgs // Struct for the recursive and Strassen multiplies.
+{
+	const double *A, *B;
+	double *C;
+	int m, n, p, lda, ldb, ldc, cutoff, numThreads;
+
+}recArgs;
+
+typedef struct strassenTask // Quadrants and products shared by one level of Strassen.
+{
+	const double *a[4], *b[4];
+	double *M[7];
+	int h, lda, ldb, cutoff;
+
+}strassenTask;
+
+typedef struct strassenWorker // Struct for the threads computing Strassen products.
+{
+	strassenTask *task;
+	int first, step, numThreads;
+
+}strassenWorker;
+
+typedef struct oocState // State shared by the prefetch and compute threads of the out-of-core multiply.
+{
+	double *A, *B, *C; // Mapped files, stored tile by tile.
+	int tile, tiles, window;
+	int started, prefetched; // C tiles handed out to compute threads / with inputs resident.
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	size_t ioBytes;
+	double ioTime;
+
+}oocState;
+
+typedef struct oocArgs // Struct for the out-of-core compute threads.
+{
+	oocState *state;
+	double computeTime;
+
+}oocArgs;
+
+typedef struct csrMatrix // Sparse matrix in compressed sparse row form.
+{
+	int n, nnz;
+	int *rowPtr, *colIdx;
+	double *vals;
+
+}csrMatrix;
+
+typedef struct sparseArgs // Struct for the SpMV / SpMM threads.
+{
+	const csrMatrix *csr;
+	const double *x;
+	double *y;
+	int rowStart, rowEnd, cols, reps;
+
+}sparseArgs;
+
+typedef struct mcsNode // Queue node of the MCS lock, one per thread.
+{
+	_Atomic(struct mcsNode *) next;
+	_Atomic int locked;
+
+}__attribute__((aligned(64))) mcsNode;
+
+typedef struct syncShared // State the sync threads contend on, hot fields on separate cache lines.
+{
+	pthread_mutex_t mutex __attribute__((aligned(64)));
+	pthread_spinlock_t spin __attribute__((aligned(64)));
+	_Atomic unsigned int ticketNext __attribute__((aligned(64)));
+	_Atomic unsigned int ticketServing __attribute__((aligned(64)));
+	_Atomic(mcsNode *) mcsTail __attribute__((aligned(64)));
+	_Atomic unsigned long long atomicCounter __attribute__((aligned(64)));
+	unsigned long long counter __attribute__((aligned(64))); // Protected by the lock under test.
+	volatile unsigned long long data[8];
+	_Atomic int stop __attribute__((aligned(64)));
+	int ready, go; // Start gate, so all threads begin together.
+	pthread_mutex_t gateLock;
+	pthread_cond_t gateCond;
+	int primitive, csLength; // Read once by each thread before the timed loop.
+
+}__attribute__((aligned(64))) syncShared;
+
+typedef struct syncArgs // Struct for the sync threads, padded so their counts don't share cache lines.
+{
+	syncShared *shared;
+	unsigned long long ops;
+	mcsNode node;
+
+}__attribute__((aligned(64))) syncArgs;
+
+static void *multiply_strassen(void *args);
+
+// This function multiplies mat1[][] and mat2[][],
+// and stores the result in res[][]
+static void *multiply_int(void *args)
+{
+	int i, j, k, temp;
+
+	multArgsI *margs; // Pass in matrix arguments. 
+	margs = (multArgsI *) args;
+
+	for(i = 0; i < margs -> size; i++)
+	{
+		for(j = 0; j < margs -> size; j++)
+		{
+			temp = margs -> mat2[i][j];
+			margs -> mat2[i][j] = margs -> mat2[j][i]; // Transpose the second matrix.
+			margs -> mat2[j][i] = temp;
+		}
+	}
+
+	for(i = margs -> threadID; i < margs -> size; i += margs -> numThreads)
+	{
+		for(j = margs -> threadID; j < margs -> size; j += margs -> numThreads)
+		{
+			for(k = margs -> threadID; k < margs -> size; k += margs -> numThreads)
+			{
+				margs -> res[i][j] += margs -> mat1[i][k] * margs-> mat2[j][k]; // Compute dot products.
+			}
+		}
+	}
+
+	pthread_exit(NULL);
+}
+
+// This function multiplies mat1[][] and mat2[][],
+// and stores the result in res[][]
+static void *multiply_double(void *args)
+{
+	multArgsD *margs; // Pass in matrix arguments.
+	int i, j, k;
+	double temp;
+
+	margs = (multArgsD *) args;
+
+	for(i = 0; i < margs -> size; i++)
+	{
+		for(j = 0; j < margs -> size; j++)
+		{
+			temp = margs -> mat2[i][j];
+			margs -> mat2[i][j] = margs -> mat2[j][i]; // Transpose.
+			margs -> mat2[j][i] = temp;
+		}
+	}
+
+	for(i = margs -> threadID; i < margs -> size; i+= margs -> numThreads)
+	{
+		for(j = margs -> threadID; j < margs -> size; j+= margs -> numThreads)
+		{
+			for(k = margs -> threadID; k < margs -> size; k+= margs -> numThreads)
+			{
+				margs -> res[i][j] += margs -> mat1[i][k] * margs -> mat2[j][k]; // Dot products.
+			}
+		}
+	}
+
+	pthread_exit(NULL);
+}
+
+
+static void *compute_flops_int(void *args)
+{
+	flopArgs *fargs; // Pass in flop arguments.
+	fargs = (flopArgs *) args;
+
+	unsigned long long int index;
+	int numFlops = (fargs -> size) / (fargs -> numThreads);
+	unsigned long long int loops = (numFlops * (unsigned long long) GIGAFLOPS) / 2; // Amount of flops.
+
+	for (index = fargs -> threadID; index < loops; index += fargs -> numThreads)
+	{
+		fargs -> intResult = fargs -> intResult + (index * 2); // Perform computations.
+	}
+
+	if(fargs -> out)
+		fprintf(fargs -> out, "%ull\n", fargs -> intResult); // Print result so calculations aren't optimized too much.
+	pthread_exit(NULL);
+}
+
+static void *compute_flops_double(void *args)
+{
+	flopArgs *fargs; // Pass in flop arguments.
+	fargs = (flopArgs *) args;
+	unsigned long long int index;
+	int numFlops = (fargs -> size) / (fargs -> numThreads);
+	unsigned long long int loops = (numFlops * (unsigned long long) GIGAFLOPS) / 2; // Amount of flops.
+
+	for (index = fargs -> threadID; index < loops; index += fargs -> numThreads)
+	{
+		fargs -> doubleResult = fargs -> doubleResult + (index * 2); // Computations
+	}
+	
+	if(fargs -> out)
+		fprintf(fargs -> out, "%f\n", fargs -> doubleResult); // Print result to avoid optimization.
+	pthread_exit(NULL);
+}
+
+// Conversions between float and the 16 bit storage formats (bf16 rounds to nearest even).
+static float bf16_to_float(uint16_t h)
+{
+	uint32_t bits = (uint32_t) h << 16;
+	float f;
+
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static uint16_t float_to_bf16(float f)
+{
+	uint32_t bits;
+
+	memcpy(&bits, &f, sizeof(bits));
+	bits += 0x7fff + ((bits >> 16) & 1);
+	return (uint16_t) (bits >> 16);
+}
+
+static float half_to_float(uint16_t h)
+{
+	uint32_t sign = (uint32_t) (h & 0x8000) << 16;
+	uint32_t exp = (h >> 10) & 0x1f;
+	uint32_t man = h & 0x3ff;
+	uint32_t bits;
+	float f;
+
+	if(exp == 0 && man == 0)
+	{
+		bits = sign;
+	}
+	else if(exp == 0) // Subnormal, renormalize for fp32.
+	{
+		exp = 113;
+
+		while(!(man & 0x400))
+		{
+			man <<= 1;
+			exp--;
+		}
+
+		bits = sign | (exp << 23) | ((man & 0x3ff) << 13);
+	}
+	else if(exp == 31)
+	{
+		bits = sign | 0x7f800000 | (man << 13);
+	}
+	else
+	{
+		bits = sign | ((exp + 112) << 23) | (man << 13);
+	}
+
+	memcpy(&f, &bits, sizeof(f));
+	return f;
+}
+
+static uint16_t float_to_half(float f)
+{
+	uint32_t bits, man;
+	uint16_t sign;
+	int exp;
+
+	memcpy(&bits, &f, sizeof(bits));
+	sign = (bits >> 16) & 0x8000;
+	exp = (int) ((bits >> 23) & 0xff) - 112;
+	man = bits & 0x7fffff;
+
+	if(exp >= 31)
+	{
+		return sign | 0x7c00; // Overflow to infinity.
+	}
+
+	if(exp <= 0)
+	{
+		if(exp < -10)
+		{
+			return sign;
+		}
+
+		man |= 0x800000;
+		return sign | ((man >> (14 - exp)) + ((man >> (13 - exp)) & 1));
+	}
+
+	return sign | ((exp << 10) + (man >> 13) + ((man >> 12) & 1));
+}
+
+// Dot products for the reduced precision kernels. Each has a portable version,
+// plus an x86 version using the dot-product instructions when the CPU has them.
+static int32_t dot_int8(const int8_t *a, const int8_t *b, int n)
+{
+	int32_t sum = 0;
+	int k;
+
+	for(k = 0; k < n; k++)
+	{
+		sum += (int32_t) a[k] * b[k];
+	}
+
+	return sum;
+}
+
+static float dot_bf16(const uint16_t *a, const uint16_t *b, int n)
+{
+	float sum = 0;
+	int k;
+
+	for(k = 0; k < n; k++)
+	{
+		sum += bf16_to_float(a[k]) * bf16_to_float(b[k]);
+	}
+
+	return sum;
+}
+
+static float dot_fp16(const uint16_t *a, const uint16_t *b, int n)
+{
+	float sum = 0;
+	int k;
+
+	for(k = 0; k < n; k++)
+	{
+		sum += half_to_float(a[k]) * half_to_float(b[k]);
+	}
+
+	return sum;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// vpdpbusd multiplies unsigned by signed bytes, so a is biased by 128 and
+// 128 * sum(b) (accumulated the same way) is subtracted at the end.
+__attribute__((target("avx2,avxvnni")))
+static int32_t dot_int8_avxvnni(const int8_t *a, const int8_t *b, int n)
+{
+	__m256i acc = _mm256_setzero_si256(), bias = _mm256_setzero_si256();
+	__m256i flip = _mm256_set1_epi8((char) 0x80);
+	int32_t lanes[8], sum = 0;
+	int k;
+
+	for(k = 0; k + 32 <= n; k += 32)
+	{
+		__m256i va = _mm256_loadu_si256((const __m256i *) (a + k));
+		__m256i vb = _mm256_loadu_si256((const __m256i *) (b + k));
+
+		acc = _mm256_dpbusd_avx_epi32(acc, _mm256_xor_si256(va, flip), vb);
+		bias = _mm256_dpbusd_avx_epi32(bias, flip, vb);
+	}
+
+	_mm256_storeu_si256((__m256i *) lanes, _mm256_sub_epi32(acc, bias));
+
+	for(int l = 0; l < 8; l++)
+	{
+		sum += lanes[l];
+	}
+
+	return sum + dot_int8(a + k, b + k, n - k);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni")))
+static int32_t dot_int8_avx512vnni(const int8_t *a, const int8_t *b, int n)
+{
+	__m512i acc = _mm512_setzero_si512(), bias = _mm512_setzero_si512();
+	__m512i flip = _mm512_set1_epi8((char) 0x80);
+	int k;
+
+	for(k = 0; k + 64 <= n; k += 64)
+	{
+		__m512i va = _mm512_loadu_si512((const void *) (a + k));
+		__m512i vb = _mm512_loadu_si512((const void *) (b + k));
+
+		acc = _mm512_dpbusd_epi32(acc, _mm512_xor_si512(va, flip), vb);
+		bias = _mm512_dpbusd_epi32(bias, flip, vb);
+	}
+
+	return _mm512_reduce_add_epi32(_mm512_sub_epi32(acc, bias)) + dot_int8(a + k, b + k, n - k);
+}
+
+__attribute__((target("avx512f,avx512bf16")))
+static float dot_bf16_avx512(const uint16_t *a, const uint16_t *b, int n)
+{
+	__m512 acc = _mm512_setzero_ps();
+	int k;
+
+	for(k = 0; k + 32 <= n; k += 32)
+	{
+		__m512i va = _mm512_loadu_si512((const void *) (a + k));
+		__m512i vb = _mm512_loadu_si512((const void *) (b + k));
+
+		acc = _mm512_dpbf16_ps(acc, (__m512bh) va, (__m512bh) vb);
+	}
+
+	return _mm512_reduce_add_ps(acc) + dot_bf16(a + k, b + k, n - k);
+}
+
+__attribute__((target("avx,fma,f16c")))
+static float dot_fp16_f16c(const uint16_t *a, const uint16_t *b, int n)
+{
+	__m256 acc = _mm256_setzero_ps();
+	float lanes[8], sum = 0;
+	int k;
+
+	for(k = 0; k + 8 <= n; k += 8)
+	{
+		__m256 va = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (a + k)));
+		__m256 vb = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *) (b + k)));
+
+		acc = _mm256_fmadd_ps(va, vb, acc);
+	}
+
+	_mm256_storeu_ps(lanes, acc);
+
+	for(int l = 0; l < 8; l++)
+	{
+		sum += lanes[l];
+	}
+
+	return sum + dot_fp16(a + k, b + k, n - k);
+}
+#endif
+
+// The reduced and mixed precision multiplies take the second matrix already transposed
+// and split rows between threads, each computing res[i][j] as a dot product of two rows.
+static void *multiply_float(void *args)
+{
+	multArgsR *margs = (multArgsR *) args;
+	const float *mat1 = (const float *) margs -> mat1;
+	const float *mat2T = (const float *) margs -> mat2T;
+	float *res = (float *) margs -> res;
+	size_t n = margs -> size;
+	size_t i, j, k;
+
+	for(i = margs -> threadID; i < n; i += margs -> numThreads)
+	{
+		for(j = 0; j < n; j++)
+		{
+			float sum = 0;
+
+			for(k = 0; k < n; k++)
+			{
+				sum += mat1[i * n + k] * mat2T[j * n + k];
+			}
+
+			res[i * n + j] = sum;
+		}
+	}
+
+	pthread_exit(NULL);
+}
+
+static void *multiply_mixed(void *args) // fp32 storage, fp64 accumulation.
+{
+	multArgsR *margs = (multArgsR *) args;
+	const float *mat1 = (const float *) margs -> mat1;
+	const float *mat2T = (const float *) margs -> mat2T;
+	float *res = (float *) margs -> res;
+	size_t n = margs -> size;
+	size_t i, j, k;
+
+	for(i = margs -> threadID; i < n; i += margs -> numThreads)
+	{
+		for(j = 0; j < n; j++)
+		{
+			double sum = 0;
+
+			for(k = 0; k < n; k++)
+			{
+				sum += (double) mat1[i * n + k] * mat2T[j * n + k];
+			}
+
+			res[i * n + j] = (float) sum;
+		}
+	}
+
+	pthread_exit(NULL);
+}
+
+static void *multiply_int8(void *args) // int8 storage, int32 accumulation.
+{
+	multArgsR *margs = (multArgsR *) args;
+	const int8_t *mat1 = (const int8_t *) margs -> mat1;
+	const int8_t *mat2T = (const int8_t *) margs -> mat2T;
+	int32_t *res = (int32_t *) margs -> res;
+	int32_t (*dot)(const int8_t *, const int8_t *, int) = dot_int8;
+	size_t n = margs -> size;
+	size_t i, j;
+
+#if defined(__x86_64__) || defined(__i386__)
+	if(__builtin_cpu_supports("avx512vnni") && __builtin_cpu_supports("avx512bw"))
+		dot = dot_int8_avx512vnni;
+	else if(__builtin_cpu_supports("avxvnni"))
+		dot = dot_int8_avxvnni;
+#endif
+
+	for(i = margs -> threadID; i < n; i += margs -> numThreads)
+	{
+		for(j = 0; j < n; j++)
+		{
+			res[i * n + j] = dot(mat1 + i * n, mat2T + j * n, n);
+		}
+	}
+
+	pthread_exit(NULL);
+}
+
+static void *multiply_bf16(void *args) // bf16 storage, fp32 accumulation.
+{
+	multArgsR *margs = (multArgsR *) args;
+	const uint16_t *mat1 = (const uint16_t *) margs -> mat1;
+	const uint16_t *mat2T = (const uint16_t *) margs -> mat2T;
+	float *res = (float *) margs -> res;
+	float (*dot)(const uint16_t *, const uint16_t *, int) = dot_bf16;
+	size_t n = margs -> size;
+	size_t i, j;
+
+#if defined(__x86_64__) || defined(__i386__)
+	if(__builtin_cpu_supports("avx512bf16"))
+		dot = dot_bf16_avx512;
+#endif
+
+	for(i = margs -> threadID; i < n; i += margs -> numThreads)
+	{
+		for(j = 0; j < n; j++)
+		{
+			res[i * n + j] = dot(mat1 + i * n, mat2T + j * n, n);
+		}
+	}
+
+	pthread_exit(NULL);
+}
+
+static void *multiply_fp16(void *args) // fp16 storage, fp32 accumulation.
+{
+	multArgsR *margs = (multArgsR *) args;
+	const uint16_t *mat1 = (const uint16_t *) margs -> mat1;
+	const uint16_t *mat2T = (const uint16_t *) margs -> mat2T;
+	float *res = (float *) margs -> res;
+	float (*dot)(const uint16_t *, const uint16_t *, int) = dot_fp16;
+	size_t n = margs -> size;
+	size_t i, j;
+
+#if defined(__x86_64__) || defined(__i386__)
+	if(__builtin_cpu_supports("f16c") && __builtin_cpu_supports("fma"))
+		dot = dot_fp16_f16c;
+#endif
+
+	for(i = margs -> threadID; i < n; i += margs -> numThreads)
+	{
+		for(j = 0; j < n; j++)
+		{
+			res[i * n + j] = dot(mat1 + i * n, mat2T + j * n, n);
+		}
+	}
+
+	pthread_exit(NULL);
+}
+
+static void *compute_flops_float(void *args)
+{
+	flopArgs *fargs; // Pass in flop arguments.
+	fargs = (flopArgs *) args;
+	unsigned long long int index;
+	int numFlops = (fargs -> size) / (fargs -> numThreads);
+	unsigned long long int loops = (numFlops * (unsigned long long) GIGAFLOPS) / 2; // Amount of flops.
+
+	for (index = fargs -> threadID; index < loops; index += fargs -> numThreads)
+	{
+		fargs -> floatResult = fargs -> floatResult + (index * 2); // Computations
+	}
+
+	if(fargs -> out)
+		fprintf(fargs -> out, "%f\n", fargs -> floatResult); // Print result to avoid optimization.
+	pthread_exit(NULL);
+}
+
+// Allocates a size x size double matrix as one contiguous block with row pointers into it,
+// so the same storage can be handed to the naive kernels and to the recursive ones.
+static double **alloc_matrix_double(int size)
+{
+	int i;
+	double **mat = (double **) malloc(sizeof(double *) * size);
+
+	mat[0] = (double *) malloc(sizeof(double) * (size_t) size * size);
+
+	for(i = 1; i < size; i++)
+	{
+		mat[i] = mat[0] + (size_t) i * size;
+	}
+
+	return mat;
+}
+
+static void free_matrix_double(double **mat)
+{
+	free(mat[0]);
+	free(mat);
+}
+
+// Blocked base case shared by the recursive and Strassen multiplies.
+// Computes C += A * B where A is m x n, B is n x p and C is m x p.
+static void base_multiply(const double *A, const double *B, double *C, int m, int n, int p, int lda, int ldb, int ldc)
+{
+	int i, j, k;
+
+	for(i = 0; i < m; i++)
+	{
+		double *c = C + (size_t) i * ldc;
+
+		for(k = 0; k < n; k++)
+		{
+			const double *b = B + (size_t) k * ldb;
+			double a = A[(size_t) i * lda + k];
+
+			for(j = 0; j < p; j++)
+			{
+				c[j] += a * b[j]; // i-k-j order keeps the inner loop unit stride.
+			}
+		}
+	}
+}
+
+// Runs fn on both halves, handing one of them to a new thread while the thread budget allows it.
+static void run_halves(void *(*fn)(void *), recArgs *first, recArgs *second, int numThreads)
+{
+	pthread_t thread;
+
+	if(numThreads > 1)
+	{
+		first -> numThreads = numThreads / 2;
+		second -> numThreads = numThreads - numThreads / 2;
+
+		if(pthread_create(&thread, NULL, fn, (void *) first) == 0)
+		{
+			fn((void *) second);
+			pthread_join(thread, NULL);
+			return;
+		}
+	}
+
+	first -> numThreads = 1;
+	second -> numThreads = 1;
+	fn((void *) first); // No threads left (or creation failed), recurse serially.
+	fn((void *) second);
+}
+
+// Cache-oblivious multiply: C += A * B, halving the largest of m, n, p until everything fits the cutoff.
+// Splits of m and p write disjoint parts of C and run in parallel, splits of n are serial.
+static void *multiply_recursive(void *args)
+{
+	recArgs *rargs; // Pass in recursion arguments.
+	recArgs first, second;
+	int h;
+
+	rargs = (recArgs *) args;
+
+	if(rargs -> m <= rargs -> cutoff && rargs -> n <= rargs -> cutoff && rargs -> p <= rargs -> cutoff)
+	{
+		base_multiply(rargs -> A, rargs -> B, rargs -> C, rargs -> m, rargs -> n, rargs -> p, rargs -> lda, rargs -> ldb, rargs -> ldc);
+		return NULL;
+	}
+
+	first = *rargs;
+	second = *rargs;
+
+	if(rargs -> m >= rargs -> n && rargs -> m >= rargs -> p) // Split the rows of A and C.
+	{
+		h = rargs -> m / 2;
+		first.m = h;
+		second.m = rargs -> m - h;
+		second.A = rargs -> A + (size_t) h * rargs -> lda;
+		second.C = rargs -> C + (size_t) h * rargs -> ldc;
+		run_halves(multiply_recursive, &first, &second, rargs -> numThreads);
+	}
+	else if(rargs -> p >= rargs -> n) // Split the columns of B and C.
+	{
+		h = rargs -> p / 2;
+		first.p = h;
+		second.p = rargs -> p - h;
+		second.B = rargs -> B + h;
+		second.C = rargs -> C + h;
+		run_halves(multiply_recursive, &first, &second, rargs -> numThreads);
+	}
+	else // Split the shared dimension, both halves accumulate into the same C.
+	{
+		h = rargs -> n / 2;
+		first.n = h;
+		second.n = rargs -> n - h;
+		second.A = rargs -> A + h;
+		second.B = rargs -> B + (size_t) h * rargs -> ldb;
+		multiply_recursive((void *) &first);
+		multiply_recursive((void *) &second);
+	}
+
+	return NULL;
+}
+
+// dst (h x h, contiguous) = x + sign * y
+static void matrix_add(double *dst, const double *x, int ldx, const double *y, int ldy, int h, double sign)
+{
+	int i, j;
+
+	for(i = 0; i < h; i++)
+	{
+		for(j = 0; j < h; j++)
+		{
+			dst[(size_t) i * h + j] = x[(size_t) i * ldx + j] + sign * y[(size_t) i * ldy + j];
+		}
+	}
+}
+
+// Computes the idx'th of the seven Strassen products into M (h x h, contiguous).
+static void strassen_product(strassenTask *task, int idx, int numThreads)
+{
+	const double **a = task -> a;
+	const double **b = task -> b;
+	int h = task -> h, lda = task -> lda, ldb = task -> ldb;
+	double *S = NULL, *T = NULL;
+	recArgs sub;
+
+	sub.m = sub.n = sub.p = h;
+	sub.C = task -> M[idx];
+	sub.ldc = h;
+	sub.cutoff = task -> cutoff;
+	sub.numThreads = numThreads;
+
+	switch(idx)
+	{
+		case 0: // M1 = (A11 + A22)(B11 + B22)
+			S = (double *) malloc(sizeof(double) * h * h);
+			T = (double *) malloc(sizeof(double) * h * h);
+			matrix_add(S, a[0], lda, a[3], lda, h, 1.0);
+			matrix_add(T, b[0], ldb, b[3], ldb, h, 1.0);
+			sub.A = S; sub.lda = h; sub.B = T; sub.ldb = h;
+			break;
+
+		case 1: // M2 = (A21 + A22) B11
+			S = (double *) malloc(sizeof(double) * h * h);
+			matrix_add(S, a[2], lda, a[3], lda, h, 1.0);
+			sub.A = S; sub.lda = h; sub.B = b[0]; sub.ldb = ldb;
+			break;
+
+		case 2: // M3 = A11 (B12 - B22)
+			T = (double *) malloc(sizeof(double) * h * h);
+			matrix_add(T, b[1], ldb, b[3], ldb, h, -1.0);
+			sub.A = a[0]; sub.lda = lda; sub.B = T; sub.ldb = h;
+			break;
+
+		case 3: // M4 = A22 (B21 - B11)
+			T = (double *) malloc(sizeof(double) * h * h);
+			matrix_add(T, b[2], ldb, b[0], ldb, h, -1.0);
+			sub.A = a[3]; sub.lda = lda; sub.B = T; sub.ldb = h;
+			break;
+
+		case 4: // M5 = (A11 + A12) B22
+			S = (double *) malloc(sizeof(double) * h * h);
+			matrix_add(S, a[0], lda, a[1], lda, h, 1.0);
+			sub.A = S; sub.lda = h; sub.B = b[3]; sub.ldb = ldb;
+			break;
+
+		case 5: // M6 = (A21 - A11)(B11 + B12)
+			S = (double *) malloc(sizeof(double) * h * h);
+			T = (double *) malloc(sizeof(double) * h * h);
+			matrix_add(S, a[2], lda, a[0], lda, h, -1.0);
+			matrix_add(T, b[0], ldb, b[1], ldb, h, 1.0);
+			sub.A = S; sub.lda = h; sub.B = T; sub.ldb = h;
+			break;
+
+		default: // M7 = (A12 - A22)(B21 + B22)
+			S = (double *) malloc(sizeof(double) * h * h);
+			T = (double *) malloc(sizeof(double) * h * h);
+			matrix_add(S, a[1], lda, a[3], lda, h, -1.0);
+			matrix_add(T, b[2], ldb, b[3], ldb, h, 1.0);
+			sub.A = S; sub.lda = h; sub.B = T; sub.ldb = h;
+			break;
+	}
+
+	multiply_strassen((void *) &sub);
+
+	free(S);
+	free(T);
+}
+
+// Worker for one level of Strassen, computes products first, first + step, ...
+static void *strassen_worker(void *args)
+{
+	strassenWorker *w = (strassenWorker *) args;
+	int idx;
+
+	for(idx = w -> first; idx < 7; idx += w -> step)
+	{
+		strassen_product(w -> task, idx, w -> numThreads);
+	}
+
+	return NULL;
+}
+
+// Strassen multiply of square matrices: C = A * B (C is overwritten).
+// Falls back to the blocked base case at the cutoff and peels the last row/column when n is odd.
+static void *multiply_strassen(void *args)
+{
+	recArgs *rargs; // Pass in recursion arguments.
+	recArgs sub;
+	strassenTask task;
+	strassenWorker workers[7];
+	pthread_t threads[7];
+	int created[7];
+	int n, h, i, j, numWorkers;
+	double *c11, *c12, *c21, *c22, **M;
+
+	rargs = (recArgs *) args;
+	n = rargs -> n;
+
+	if(n <= rargs -> cutoff)
+	{
+		for(i = 0; i < n; i++)
+		{
+			memset(rargs -> C + (size_t) i * rargs -> ldc, 0, sizeof(double) * n);
+		}
+
+		base_multiply(rargs -> A, rargs -> B, rargs -> C, n, n, n, rargs -> lda, rargs -> ldb, rargs -> ldc);
+		return NULL;
+	}
+
+	if(n % 2) // Odd size: Strassen on the even leading block, thin products for the rest.
+	{
+		int e = n - 1;
+
+		sub = *rargs;
+		sub.m = sub.n = sub.p = e;
+		multiply_strassen((void *) &sub);
+
+		for(i = 0; i < n; i++)
+		{
+			rargs -> C[(size_t) i * rargs -> ldc + e] = 0.0;
+		}
+
+		memset(rargs -> C + (size_t) e * rargs -> ldc, 0, sizeof(double) * e);
+
+		sub = *rargs; // C11 += A12 * B21 (rank one update)
+		sub.m = e; sub.n = 1; sub.p = e;
+		sub.A = rargs -> A + e;
+		sub.B = rargs -> B + (size_t) e * rargs -> ldb;
+		multiply_recursive((void *) &sub);
+
+		sub = *rargs; // Last column of C.
+		sub.m = n; sub.n = n; sub.p = 1;
+		sub.B = rargs -> B + e;
+		sub.C = rargs -> C + e;
+		multiply_recursive((void *) &sub);
+
+		sub = *rargs; // Last row of C, minus the corner already computed.
+		sub.m = 1; sub.n = n; sub.p = e;
+		sub.A = rargs -> A + (size_t) e * rargs -> lda;
+		sub.C = rargs -> C + (size_t) e * rargs -> ldc;
+		multiply_recursive((void *) &sub);
+
+		return NULL;
+	}
+
+	h = n / 2;
+	task.h = h;
+	task.lda = rargs -> lda;
+	task.ldb = rargs -> ldb;
+	task.cutoff = rargs -> cutoff;
+	task.a[0] = rargs -> A;
+	task.a[1] = rargs -> A + h;
+	task.a[2] = rargs -> A + (size_t) h * rargs -> lda;
+	task.a[3] = rargs -> A + (size_t) h * rargs -> lda + h;
+	task.b[0] = rargs -> B;
+	task.b[1] = rargs -> B + h;
+	task.b[2] = rargs -> B + (size_t) h * rargs -> ldb;
+	task.b[3] = rargs -> B + (size_t) h * rargs -> ldb + h;
+	M = task.M;
+
+	for(i = 0; i < 7; i++)
+	{
+		M[i] = (double *) malloc(sizeof(double) * h * h);
+	}
+
+	numWorkers = rargs -> numThreads < 7 ? rargs -> numThreads : 7;
+
+	if(numWorkers < 1)
+	{
+		numWorkers = 1;
+	}
+
+	for(i = 0; i < numWorkers; i++)
+	{
+		workers[i].task = &task;
+		workers[i].first = i;
+		workers[i].step = numWorkers; // Spread the seven products over the available threads.
+		workers[i].numThreads = rargs -> numThreads / numWorkers;
+		created[i] = 0;
+
+		if(i > 0)
+		{
+			created[i] = pthread_create(&threads[i], NULL, strassen_worker, (void *) &workers[i]) == 0;
+		}
+	}
+
+	strassen_worker((void *) &workers[0]);
+
+	for(i = 1; i < numWorkers; i++)
+	{
+		if(created[i])
+		{
+			pthread_join(threads[i], NULL);
+		}
+		else
+		{
+			strassen_worker((void *) &workers[i]);
+		}
+	}
+
+	c11 = rargs -> C;
+	c12 = rargs -> C + h;
+	c21 = rargs -> C + (size_t) h * rargs -> ldc;
+	c22 = rargs -> C + (size_t) h * rargs -> ldc + h;
+
+	for(i = 0; i < h; i++)
+	{
+		for(j = 0; j < h; j++)
+		{
+			size_t q = (size_t) i * h + j;
+			size_t o = (size_t) i * rargs -> ldc + j;
+
+			c11[o] = M[0][q] + M[3][q] - M[4][q] + M[6][q];
+			c12[o] = M[2][q] + M[4][q];
+			c21[o] = M[1][q] + M[3][q];
+			c22[o] = M[0][q] - M[1][q] + M[2][q] + M[5][q];
+		}
+	}
+
+	for(i = 0; i < 7; i++)
+	{
+		free(M[i]);
+	}
+
+	return NULL;
+}
+
+
+// Creates an unlinked scratch file of the given size in dir and maps it shared.
+static double *map_matrix_file(const char *dir, size_t bytes, int *fd)
+{
+	char path[4096];
+	double *data;
+
+	snprintf(path, sizeof(path), "%s/cpubench-XXXXXX", dir);
+	*fd = mkstemp(path);
+
+	if(*fd == -1)
+	{
+		return NULL;
+	}
+
+	unlink(path); // The file lives until the descriptor is closed.
+
+	if(ftruncate(*fd, bytes) == -1)
+	{
+		close(*fd);
+		return NULL;
+	}
+
+	data = (double *) mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+
+	if(data == MAP_FAILED)
+	{
+		close(*fd);
+		return NULL;
+	}
+
+	return data;
+}
+
+// Writes a mapped matrix back and drops it from the page cache so the benchmark starts cold.
+static void evict_matrix_file(double *data, size_t bytes, int fd)
+{
+	msync(data, bytes, MS_SYNC);
+	madvise(data, bytes, MADV_DONTNEED);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+}
+
+// Offset of element (i, j) in a tile-major matrix, where each tile x tile block is contiguous.
+static size_t tile_index(int i, int j, int tile, int tiles)
+{
+	return ((size_t) (i / tile) * tiles + j / tile) * tile * tile + (size_t) (i % tile) * tile + j % tile;
+}
+
+// Asks the kernel to read a range ahead and then touches every page so it is resident on return.
+// Returns the bytes that actually had to come from the file (pages not in the page cache beforehand,
+// as reported by mincore) and adds the time spent on ranges that needed any to ioTime.
+static size_t prefetch_range(const double *addr, size_t bytes, double *ioTime)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	uintptr_t first = (uintptr_t) addr & ~(uintptr_t) (page - 1);
+	uintptr_t last = (uintptr_t) addr + bytes;
+	size_t pages = (last - first + page - 1) / page, missing = 0, i;
+	unsigned char *resident = (unsigned char *) malloc(pages);
+	volatile char sink = 0;
+	struct timeval start, end;
+	uintptr_t p;
+
+	if(resident != NULL && mincore((void *) first, last - first, resident) == 0)
+	{
+		for(i = 0; i < pages; i++)
+		{
+			missing += !(resident[i] & 1);
+		}
+	}
+	else
+	{
+		missing = pages; // Unknown, count it all as read.
+	}
+
+	free(resident);
+
+	gettimeofday(&start, NULL);
+	madvise((void *) first, last - first, MADV_WILLNEED);
+
+	for(p = first; p < last; p += page)
+	{
+		sink += *(const volatile char *) p;
+	}
+
+	gettimeofday(&end, NULL);
+
+	if(missing > 0)
+		*ioTime += ((end.tv_sec * 1000000 + end.tv_usec) - (start.tv_sec * 1000000 + start.tv_usec)) / 1000000.0;
+
+	(void) sink;
+	return missing * page;
+}
+
+// Prefetch thread: walks the C tiles in order, faulting in the A row panel and B column panel
+// a window of tiles ahead of the compute threads. Only pages that had to come from the file count as I/O.
+static void *prefetch_tiles(void *args)
+{
+	oocState *st = (oocState *) args;
+	size_t tileBytes = sizeof(double) * st -> tile * st -> tile;
+	int t, ti, tj, k;
+
+	for(t = 0; t < st -> tiles * st -> tiles; t++)
+	{
+		pthread_mutex_lock(&st -> lock);
+
+		while(t >= st -> started + st -> window)
+		{
+			pthread_cond_wait(&st -> cond, &st -> lock); // Don't run too far ahead of the consumers.
+		}
+
+		pthread_mutex_unlock(&st -> lock);
+
+		ti = t / st -> tiles;
+		tj = t % st -> tiles;
+
+		for(k = 0; k < st -> tiles; k++)
+		{
+			if(tj == 0) // The A panel is shared by the whole row of C tiles.
+			{
+				st -> ioBytes += prefetch_range(st -> A + ((size_t) ti * st -> tiles + k) * st -> tile * st -> tile, tileBytes, &st -> ioTime);
+			}
+
+			st -> ioBytes += prefetch_range(st -> B + ((size_t) k * st -> tiles + tj) * st -> tile * st -> tile, tileBytes, &st -> ioTime);
+		}
+
+		pthread_mutex_lock(&st -> lock);
+		st -> prefetched = t + 1;
+		pthread_cond_broadcast(&st -> cond);
+		pthread_mutex_unlock(&st -> lock);
+	}
+
+	return NULL;
+}
+
+// Compute thread: takes the next C tile, waits for its inputs to be prefetched,
+// accumulates it in memory over the shared dimension and stores it into the mapped C.
+static void *multiply_tiles(void *args)
+{
+	oocArgs *oargs = (oocArgs *) args;
+	oocState *st = oargs -> state;
+	int tile = st -> tile, tiles = st -> tiles;
+	size_t tileElems = (size_t) tile * tile;
+	double *acc = (double *) malloc(sizeof(double) * tileElems);
+	struct timeval start, end;
+	int t, ti, tj, k;
+
+	oargs -> computeTime = 0;
+
+	for(;;)
+	{
+		pthread_mutex_lock(&st -> lock);
+		t = st -> started++;
+		pthread_cond_broadcast(&st -> cond);
+
+		while(t < tiles * tiles && st -> prefetched <= t)
+		{
+			pthread_cond_wait(&st -> cond, &st -> lock);
+		}
+
+		pthread_mutex_unlock(&st -> lock);
+
+		if(t >= tiles * tiles)
+		{
+			break;
+		}
+
+		ti = t / tiles;
+		tj = t % tiles;
+
+		gettimeofday(&start, NULL);
+		memset(acc, 0, sizeof(double) * tileElems);
+
+		for(k = 0; k < tiles; k++)
+		{
+			base_multiply(st -> A + ((size_t) ti * tiles + k) * tileElems, st -> B + ((size_t) k * tiles + tj) * tileElems, acc, tile, tile, tile, tile, tile, tile);
+		}
+
+		memcpy(st -> C + ((size_t) ti * tiles + tj) * tileElems, acc, sizeof(double) * tileElems);
+		gettimeofday(&end, NULL);
+
+		oargs -> computeTime += ((end.tv_sec * 1000000 + end.tv_usec) - (start.tv_sec * 1000000 + start.tv_usec)) / 1000000.0;
+	}
+
+	free(acc);
+	return NULL;
+}
+
+
+static int compare_int(const void *a, const void *b)
+{
+	return (*(const int *) a > *(const int *) b) - (*(const int *) a < *(const int *) b);
+}
+
+// Generates a random n x n CSR matrix with roughly density * n * n non zeros.
+// structure 0: uniform random columns, 1: a band around the diagonal,
+// 2: power-law row lengths (row weight 1 / rank, ranks shuffled over the rows).
+static int generate_csr(csrMatrix *csr, int n, int structure, double density)
+{
+	int *rowLen = (int *) malloc(sizeof(int) * n);
+	double target = density * n * (double) n;
+	double harmonic = 0;
+	int i, j, k, len, half;
+	size_t nnz = 0;
+
+	csr -> n = n;
+	half = (int) (density * n / 2);
+
+	for(i = 0; i < n; i++) // Row lengths first.
+	{
+		if(structure == 1)
+		{
+			int lo = i - half < 0 ? 0 : i - half;
+			int hi = i + half >= n ? n - 1 : i + half;
+			rowLen[i] = hi - lo + 1;
+		}
+		else
+		{
+			rowLen[i] = (int) (density * n + 0.5);
+		}
+
+		harmonic += 1.0 / (i + 1);
+	}
+
+	if(structure == 2)
+	{
+		for(i = 0; i < n; i++)
+		{
+			rowLen[i] = (int) (target / harmonic / (i + 1) + 0.5);
+		}
+
+		for(i = n - 1; i > 0; i--) // Shuffle so the heavy rows aren't all at the top.
+		{
+			j = rand() % (i + 1);
+			len = rowLen[i];
+			rowLen[i] = rowLen[j];
+			rowLen[j] = len;
+		}
+	}
+
+	for(i = 0; i < n; i++)
+	{
+		rowLen[i] = rowLen[i] < 1 ? 1 : (rowLen[i] > n ? n : rowLen[i]);
+		nnz += rowLen[i];
+	}
+
+	if(nnz > 0x7fffffff)
+	{
+		free(rowLen);
+		return -1; // Row pointers are int.
+	}
+
+	csr -> rowPtr = (int *) malloc(sizeof(int) * (n + 1));
+	csr -> colIdx = (int *) malloc(sizeof(int) * nnz);
+	csr -> vals = (double *) malloc(sizeof(double) * nnz);
+	csr -> rowPtr[0] = 0;
+
+	for(i = 0; i < n; i++)
+	{
+		int *cols = csr -> colIdx + csr -> rowPtr[i];
+
+		len = rowLen[i];
+
+		if(structure == 1)
+		{
+			int lo = i - half < 0 ? 0 : i - half;
+
+			for(k = 0; k < len; k++)
+				cols[k] = lo + k;
+		}
+		else if(len == n)
+		{
+			for(k = 0; k < len; k++)
+				cols[k] = k;
+		}
+		else
+		{
+			for(k = 0; k < len; k++)
+				cols[k] = rand() % n;
+
+			qsort(cols, len, sizeof(int), compare_int);
+
+			for(j = 0, k = 1; k < len; k++) // Drop duplicate columns.
+			{
+				if(cols[k] != cols[j])
+					cols[++j] = cols[k];
+			}
+
+			len = j + 1;
+		}
+
+		for(k = 0; k < len; k++)
+			csr -> vals[csr -> rowPtr[i] + k] = (double) rand() / RAND_MAX;
+
+		csr -> rowPtr[i + 1] = csr -> rowPtr[i] + len;
+	}
+
+	csr -> nnz = csr -> rowPtr[n];
+	free(rowLen);
+	return 0;
+}
+
+static void free_csr(csrMatrix *csr)
+{
+	free(csr -> rowPtr);
+	free(csr -> colIdx);
+	free(csr -> vals);
+}
+
+// Splits the rows into contiguous ranges holding about the same number of non zeros each,
+// so a few long rows don't leave the other threads idle.
+static void partition_rows(const csrMatrix *csr, int numThreads, int *bounds)
+{
+	int t, lo, hi, mid;
+
+	bounds[0] = 0;
+
+	for(t = 1; t < numThreads; t++)
+	{
+		long long goal = (long long) csr -> nnz * t / numThreads;
+
+		lo = bounds[t - 1];
+		hi = csr -> n;
+
+		while(lo < hi) // First row starting at or past the goal.
+		{
+			mid = lo + (hi - lo) / 2;
+
+			if(csr -> rowPtr[mid] < goal)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+
+		bounds[t] = lo;
+	}
+
+	bounds[numThreads] = csr -> n;
+}
+
+// y = A * x over this thread's rows, reps times.
+static void *spmv_csr(void *args)
+{
+	sparseArgs *sargs = (sparseArgs *) args;
+	const csrMatrix *csr = sargs -> csr;
+	int rep, i, k;
+
+	for(rep = 0; rep < sargs -> reps; rep++)
+	{
+		for(i = sargs -> rowStart; i < sargs -> rowEnd; i++)
+		{
+			double sum = 0;
+
+			for(k = csr -> rowPtr[i]; k < csr -> rowPtr[i + 1]; k++)
+			{
+				sum += csr -> vals[k] * sargs -> x[csr -> colIdx[k]];
+			}
+
+			sargs -> y[i] = sum;
+		}
+	}
+
+	pthread_exit(NULL);
+}
+
+// Y = A * X over this thread's rows, reps times, where X and Y are dense row-major with cols columns.
+static void *spmm_csr(void *args)
+{
+	sparseArgs *sargs = (sparseArgs *) args;
+	const csrMatrix *csr = sargs -> csr;
+	int cols = sargs -> cols;
+	int rep, i, j, k;
+
+	for(rep = 0; rep < sargs -> reps; rep++)
+	{
+		for(i = sargs -> rowStart; i < sargs -> rowEnd; i++)
+		{
+			double *y = sargs -> y + (size_t) i * cols;
+
+			for(j = 0; j < cols; j++)
+				y[j] = 0;
+
+			for(k = csr -> rowPtr[i]; k < csr -> rowPtr[i + 1]; k++)
+			{
+				const double *x = sargs -> x + (size_t) csr -> colIdx[k] * cols;
+				double a = csr -> vals[k];
+
+				for(j = 0; j < cols; j++)
+					y[j] += a * x[j];
+			}
+		}
+	}
+
+	pthread_exit(NULL);
+}
+
+
+static void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	_mm_pause();
+#endif
+}
+
+static void mcs_lock(_Atomic(mcsNode *) *tail, mcsNode *node)
+{
+	mcsNode *pred;
+
+	atomic_store_explicit(&node -> next, NULL, memory_order_relaxed);
+	atomic_store_explicit(&node -> locked, 1, memory_order_relaxed);
+	pred = atomic_exchange_explicit(tail, node, memory_order_acq_rel);
+
+	if(pred != NULL) // Queue behind pred and spin on our own node.
+	{
+		atomic_store_explicit(&pred -> next, node, memory_order_release);
+
+		while(atomic_load_explicit(&node -> locked, memory_order_acquire))
+			cpu_relax();
+	}
+}
+
+static void mcs_unlock(_Atomic(mcsNode *) *tail, mcsNode *node)
+{
+	mcsNode *next = atomic_load_explicit(&node -> next, memory_order_acquire);
+
+	if(next == NULL)
+	{
+		mcsNode *expected = node;
+
+		if(atomic_compare_exchange_strong_explicit(tail, &expected, NULL, memory_order_release, memory_order_relaxed))
+			return; // Nobody waiting.
+
+		while((next = atomic_load_explicit(&node -> next, memory_order_acquire)) == NULL)
+			cpu_relax(); // A successor is still linking itself in.
+	}
+
+	atomic_store_explicit(&next -> locked, 0, memory_order_release);
+}
+
+// Stand-in for the work done on shared state inside a critical section.
+static void critical_work(volatile unsigned long long *data, int length)
+{
+	int w;
+
+	for(w = 0; w < length; w++)
+	{
+		data[w & 7] += w;
+	}
+}
+
+// Runs critical sections on the shared counter until told to stop, counting its own ops.
+// The lock based primitives do the work on shared data while holding the lock; atomic and
+// sharded have no lock to hold, so they do it on thread local data next to the update.
+static void *sync_worker(void *args)
+{
+	syncArgs *sargs = (syncArgs *) args;
+	syncShared *shared = sargs -> shared;
+	volatile unsigned long long local[8] = {0};
+	unsigned int ticket;
+	int primitive = shared -> primitive; // Kept in registers, off the contended lines.
+	int csLength = shared -> csLength;
+
+	pthread_mutex_lock(&shared -> gateLock);
+	shared -> ready++;
+	pthread_cond_broadcast(&shared -> gateCond);
+
+	while(!shared -> go)
+		pthread_cond_wait(&shared -> gateCond, &shared -> gateLock);
+
+	pthread_mutex_unlock(&shared -> gateLock);
+
+	while(!atomic_load_explicit(&shared -> stop, memory_order_relaxed))
+	{
+		switch(primitive)
+		{
+			case 0: // mutex
+				pthread_mutex_lock(&shared -> mutex);
+				shared -> counter++;
+				critical_work(shared -> data, csLength);
+				pthread_mutex_unlock(&shared -> mutex);
+				break;
+
+			case 1: // spin
+				pthread_spin_lock(&shared -> spin);
+				shared -> counter++;
+				critical_work(shared -> data, csLength);
+				pthread_spin_unlock(&shared -> spin);
+				break;
+
+			case 2: // ticket
+				ticket = atomic_fetch_add_explicit(&shared -> ticketNext, 1, memory_order_relaxed);
+
+				while(atomic_load_explicit(&shared -> ticketServing, memory_order_acquire) != ticket)
+					cpu_relax();
+
+				shared -> counter++;
+				critical_work(shared -> data, csLength);
+				atomic_store_explicit(&shared -> ticketServing, ticket + 1, memory_order_release);
+				break;
+
+			case 3: // mcs
+				mcs_lock(&shared -> mcsTail, &sargs -> node);
+				shared -> counter++;
+				critical_work(shared -> data, csLength);
+				mcs_unlock(&shared -> mcsTail, &sargs -> node);
+				break;
+
+			case 4: // atomic
+				atomic_fetch_add_explicit(&shared -> atomicCounter, 1, memory_order_relaxed);
+				critical_work(local, csLength);
+				break;
+
+			default: // sharded, ops below is this thread's shard of the counter.
+				critical_work(local, csLength);
+				break;
+		}
+
+		sargs -> ops++;
+	}
+
+	pthread_exit(NULL);
+}
+
+// Runs one point of the sync sweep for duration_ms and reports ops/sec, Jain's fairness index
+// over the per thread op counts and the min/max per thread ratio. Returns the total ops, or 0 on error.
+static unsigned long long sync_point(int primitive, int numThreads, int csLength, int duration_ms, double *opsPerSec, double *fairness, double *minMax, benchResult *result)
+{
+	syncShared *shared = (syncShared *) aligned_alloc(64, sizeof(syncShared));
+	syncArgs *sargs = (syncArgs *) aligned_alloc(64, sizeof(syncArgs) * numThreads);
+	pthread_t threads[numThreads];
+	struct timeval start, end;
+	unsigned long long total = 0, least = ~0ull, most = 0, expect;
+	double sumSquares = 0, elapsed;
+	int i, created;
+
+	memset(shared, 0, sizeof(syncShared));
+	shared -> primitive = primitive;
+	shared -> csLength = csLength;
+	pthread_mutex_init(&shared -> mutex, NULL);
+	pthread_spin_init(&shared -> spin, PTHREAD_PROCESS_PRIVATE);
+	atomic_init(&shared -> ticketNext, 0);
+	atomic_init(&shared -> ticketServing, 0);
+	atomic_init(&shared -> mcsTail, NULL);
+	atomic_init(&shared -> atomicCounter, 0);
+	atomic_init(&shared -> stop, 0);
+	pthread_mutex_init(&shared -> gateLock, NULL);
+	pthread_cond_init(&shared -> gateCond, NULL);
+
+	for(created = 0; created < numThreads; created++)
+	{
+		memset(&sargs[created], 0, sizeof(syncArgs));
+		sargs[created].shared = shared;
+
+		if(pthread_create(&threads[created], NULL, sync_worker, (void *) &sargs[created]))
+		{
+			bench_fail(result, "Error: unable to create one or more threads");
+			atomic_store(&shared -> stop, 1); // Let the ones already started go and finish at once.
+			break;
+		}
+	}
+
+	pthread_mutex_lock(&shared -> gateLock);
+
+	while(shared -> ready < created)
+		pthread_cond_wait(&shared -> gateCond, &shared -> gateLock);
+
+	shared -> go = 1; // Everybody starts together.
+	pthread_cond_broadcast(&shared -> gateCond);
+	pthread_mutex_unlock(&shared -> gateLock);
+
+	gettimeofday(&start, NULL);
+
+	if(created == numThreads)
+		usleep(duration_ms * 1000);
+
+	atomic_store(&shared -> stop, 1);
+
+	for(i = 0; i < created; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+
+	gettimeofday(&end, NULL);
+	elapsed = bench_seconds(&start, &end);
+
+	if(created < numThreads)
+	{
+		numThreads = 0; // Nothing to report, the error is already set.
+	}
+
+	for(i = 0; i < numThreads; i++)
+	{
+		total += sargs[i].ops;
+		sumSquares += (double) sargs[i].ops * sargs[i].ops;
+		least = sargs[i].ops < least ? sargs[i].ops : least;
+		most = sargs[i].ops > most ? sargs[i].ops : most;
+	}
+
+	expect = (primitive == 4) ? atomic_load(&shared -> atomicCounter) : (primitive == 5) ? total : shared -> counter;
+
+	if(numThreads == 0)
+	{
+		total = 0;
+	}
+	else if(expect != total)
+	{
+		bench_fail(result, primitive < 4 ? "Error: lock lost updates" : "Error: atomic lost updates");
+		total = 0;
+	}
+
+	*opsPerSec = total / elapsed;
+	*fairness = sumSquares > 0 && numThreads > 0 ? (double) total * total / (numThreads * sumSquares) : 0;
+	*minMax = most > 0 ? (double) least / most : 0;
+
+	pthread_mutex_destroy(&shared -> mutex);
+	pthread_spin_destroy(&shared -> spin);
+	pthread_mutex_destroy(&shared -> gateLock);
+	pthread_cond_destroy(&shared -> gateCond);
+	free(shared);
+	free(sargs);
+	return total;
+}
+
+
+
+// Index of a cpubench type name (single, double, float, mixed, int8, bf16, fp16), -1 if unknown.
+static int parse_type(const char *name)
+{
+	const char *types[] = {"single", "double", "float", "mixed", "int8", "bf16", "fp16"};
+	int i;
+
+	for(i = 0; i < 7; i++)
+	{
+		if(strcmp(name, types[i]) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+static int run_flops(const benchParams *params, benchResult *result)
+{
+	int type = parse_type(params -> type);
+	int num_threads = params -> threads;
+	flopArgs fargs[num_threads];
+	void *(*kernel)(void *);
+	struct timeval start, end;
+	int i;
+
+	if(type == 0)
+		kernel = compute_flops_int;
+	else if(type == 1)
+		kernel = compute_flops_double;
+	else if(type == 2)
+		kernel = compute_flops_float;
+	else
+		return BENCH_EUSAGE;
+
+	for(i = 0; i < num_threads; i++)
+	{
+		fargs[i].size = params -> size;
+		fargs[i].numThreads = num_threads; // Init flops struct.
+		fargs[i].threadID = i;
+		fargs[i].intResult = 0;
+		fargs[i].floatResult = 0;
+		fargs[i].doubleResult = 0;
+		fargs[i].out = params -> out;
+	}
+
+	gettimeofday(&start, NULL);
+
+	if(bench_threads(kernel, fargs, sizeof(flopArgs), num_threads, result))
+		return BENCH_EFAIL;
+
+	gettimeofday(&end, NULL);
+
+	result -> elapsed = bench_seconds(&start, &end);
+	result -> gigaOps = params -> size;
+	result -> ops = (double) params -> size * GIGAFLOPS;
+	return BENCH_OK;
+}
+
+// The naive single / double multiplies and the flat reduced / mixed precision ones.
+static int run_matrix(const benchParams *params, benchResult *result)
+{
+	int type = parse_type(params -> type);
+	int num_threads = params -> threads;
+	unsigned long long size = params -> size;
+	struct timeval start, end;
+	int i, j, k, r;
+
+	if(type == 0) // matrix int
+	{
+		multArgsI margsI[num_threads];
+		int **mat1I = (int **) malloc(sizeof(int *) * size);
+		int **mat2I = (int **) malloc(sizeof(int *) * size);
+		int **resI = (int **) malloc(sizeof(int *) * size);
+
+		for(i = 0; i < size; i++)
+		{
+			mat1I[i] = (int *) malloc(sizeof(int) * size);
+			mat2I[i] = (int *) malloc(sizeof(int) * size); // Allocate the memory needed for 3 matrices.
+			resI[i] = (int *) malloc(sizeof(int) * size);
+
+			for(j = 0; j < size; j++)
+			{
+				mat1I[i][j] = (int) rand();
+				mat2I[i][j] = (int) rand();
+				resI[i][j] = 0;
+			}
+		}
+
+		for(k = 0; k < num_threads; k++)
+		{
+			margsI[k].mat1 = mat1I;
+			margsI[k].mat2 = mat2I;
+			margsI[k].res = resI; // Struct init.
+			margsI[k].threadID = k;
+			margsI[k].numThreads = num_threads;
+			margsI[k].size = size;
+		}
+
+		gettimeofday(&start, NULL);
+		r = bench_threads(multiply_int, margsI, sizeof(multArgsI), num_threads, result);
+		gettimeofday(&end, NULL);
+
+		for(i = 0; i < size; i++)
+		{
+			free(mat1I[i]);
+			free(mat2I[i]);
+			free(resI[i]);
+		}
+
+		free(mat1I);
+		free(mat2I); // Free the allocated memory.
+		free(resI);
+	}
+	else if(type == 1) // matrix double
+	{
+		multArgsD margsD[num_threads];
+		double **mat1 = (double **) malloc(sizeof(double *) * size);
+		double **mat2 = (double **) malloc(sizeof(double *) * size); // Again largely the same as matrix single save for the types.
+		double **res = (double **) malloc(sizeof(double *) * size);
+
+		for(i = 0; i < size; i++)
+		{
+			mat1[i] = (double *) malloc(sizeof(double) * size);
+			mat2[i] = (double *) malloc(sizeof(double) * size);
+			res[i] = (double *) malloc(sizeof(double) * size);
+
+			for(j = 0; j < size; j++)
+			{
+				mat1[i][j] = rand();
+				mat2[i][j] = rand();
+				res[i][j] = 0.0;
+			}
+		}
+
+		for(k = 0; k < num_threads; k++)
+		{
+			margsD[k].mat1 = mat1;
+			margsD[k].mat2 = mat2;
+			margsD[k].res = res;
+			margsD[k].threadID = k;
+			margsD[k].numThreads = num_threads;
+			margsD[k].size = size;
+		}
+
+		gettimeofday(&start, NULL);
+		r = bench_threads(multiply_double, margsD, sizeof(multArgsD), num_threads, result);
+		gettimeofday(&end, NULL);
+
+		for(i = 0; i < size; i++)
+		{
+			free(mat1[i]);
+			free(mat2[i]);
+			free(res[i]);
+		}
+
+		free(mat1);
+		free(mat2);
+		free(res);
+	}
+	else if(type >= 2) // matrix float / mixed / int8 / bf16 / fp16
+	{
+		size_t elems = (size_t) size * size;
+		size_t elemSize = (type == 4) ? sizeof(int8_t) : (type >= 5) ? sizeof(uint16_t) : sizeof(float);
+		void *(*kernel)(void *);
+		char *matA = (char *) malloc(elemSize * elems);
+		char *matBT = (char *) malloc(elemSize * elems); // Generated directly in transposed form.
+		void *resR = malloc(sizeof(float) * elems); // float or int32 results.
+		multArgsR margsR[num_threads];
+
+		for(size_t e = 0; e < 2 * elems; e++)
+		{
+			char *dst = (e < elems) ? matA + e * elemSize : matBT + (e - elems) * elemSize;
+			float v = (float) rand() / RAND_MAX * 2.0f - 1.0f; // [-1, 1] keeps fp16 in range.
+
+			if(type == 4)
+				*(int8_t *) dst = (int8_t) (rand() % 256 - 128);
+			else if(type == 5)
+				*(uint16_t *) dst = float_to_bf16(v);
+			else if(type == 6)
+				*(uint16_t *) dst = float_to_half(v);
+			else
+				*(float *) dst = v;
+		}
+
+		if(type == 2)
+			kernel = multiply_float;
+		else if(type == 3)
+			kernel = multiply_mixed;
+		else if(type == 4)
+			kernel = multiply_int8;
+		else if(type == 5)
+			kernel = multiply_bf16;
+		else
+			kernel = multiply_fp16;
+
+		for(k = 0; k < num_threads; k++)
+		{
+			margsR[k].mat1 = matA;
+			margsR[k].mat2T = matBT;
+			margsR[k].res = resR;
+			margsR[k].threadID = k;
+			margsR[k].numThreads = num_threads;
+			margsR[k].size = size;
+		}
+
+		gettimeofday(&start, NULL);
+		r = bench_threads(kernel, margsR, sizeof(multArgsR), num_threads, result);
+		gettimeofday(&end, NULL);
+
+		free(matA);
+		free(matBT);
+		free(resR);
+	}
+	else
+	{
+		return BENCH_EUSAGE;
+	}
+
+	if(r)
+		return BENCH_EFAIL;
+
+	result -> elapsed = bench_seconds(&start, &end);
+	result -> gigaOps = (size * size * size) / (GIGABYTES);
+	result -> ops = 2.0 * size * size * size; // A multiply-add counts as two ops.
+
+	if(type <= 1)
+	{
+		// multiply_int / multiply_double stride i, j and k all by the thread count, so thread t only
+		// does c^3 multiply-adds, c being the number of indices congruent to t. Count that, not n^3.
+		result -> ops = 0;
+
+		for(k = 0; k < num_threads && k < size; k++)
+		{
+			double c = (size - k + num_threads - 1) / num_threads;
+
+			result -> ops += 2.0 * c * c * c;
+		}
+	}
+
+	return BENCH_OK;
+}
+
+// Recursive / Strassen double multiply, checked against the naive kernel on one thread.
+static int run_recursive_common(const benchParams *params, benchResult *result, int strassen)
+{
+	int cutoff = params -> options[0] ? atoi(params -> options[0]) : DEFAULT_CUTOFF;
+	unsigned long long size = params -> size;
+	double **mat1, **mat2, **res, **ref;
+	double naive_time_sec, max_err = 0, max_ref = 0;
+	struct timeval start, end, naive_start, naive_end;
+	multArgsD margsD;
+	int i, j, r;
+
+	if(parse_type(params -> type) != 1 || cutoff <= 0)
+		return BENCH_EUSAGE;
+
+	mat1 = alloc_matrix_double(size);
+	mat2 = alloc_matrix_double(size);
+	res = alloc_matrix_double(size);
+	ref = alloc_matrix_double(size);
+
+	for(i = 0; i < size; i++)
+	{
+		for(j = 0; j < size; j++)
+		{
+			mat1[i][j] = rand();
+			mat2[i][j] = rand();
+			res[i][j] = 0.0;
+			ref[i][j] = 0.0;
+		}
+	}
+
+	recArgs rargs = {mat1[0], mat2[0], res[0], size, size, size, size, size, size, cutoff, params -> threads};
+
+	gettimeofday(&start, NULL);
+
+	if(strassen)
+		multiply_strassen((void *) &rargs);
+	else
+		multiply_recursive((void *) &rargs); // Spawns its own threads while recursing.
+
+	gettimeofday(&end, NULL);
+
+	// Reference result from the naive kernel on one thread (it is only complete with a single thread).
+	// multiply_double takes the second matrix by rows (mat2[j][k]), so hand it the transpose.
+	for(i = 0; i < size; i++)
+	{
+		for(j = i + 1; j < size; j++)
+		{
+			double temp = mat2[i][j];
+			mat2[i][j] = mat2[j][i];
+			mat2[j][i] = temp;
+		}
+	}
+
+	margsD.mat1 = mat1;
+	margsD.mat2 = mat2;
+	margsD.res = ref;
+	margsD.threadID = 0;
+	margsD.numThreads = 1;
+	margsD.size = size;
+
+	gettimeofday(&naive_start, NULL);
+	r = bench_threads(multiply_double, &margsD, sizeof(multArgsD), 1, result);
+	gettimeofday(&naive_end, NULL);
+	naive_time_sec = bench_seconds(&naive_start, &naive_end);
+
+	for(i = 0; i < size; i++)
+	{
+		for(j = 0; j < size; j++)
+		{
+			double diff = res[i][j] - ref[i][j];
+			double mag = ref[i][j] < 0 ? -ref[i][j] : ref[i][j];
+
+			if(diff < 0)
+				diff = -diff;
+			if(diff > max_err)
+				max_err = diff;
+			if(mag > max_ref)
+				max_ref = mag;
+		}
+	}
+
+	free_matrix_double(mat1);
+	free_matrix_double(mat2);
+	free_matrix_double(res);
+	free_matrix_double(ref);
+
+	if(r)
+		return BENCH_EFAIL;
+
+	result -> elapsed = bench_seconds(&start, &end);
+	result -> gigaOps = (size * size * size) / (GIGABYTES);
+	result -> ops = 2.0 * size * size * size;
+	bench_metric(result, "cutoff", "%.0f", cutoff);
+	bench_metric(result, "naive_time", "%lf", naive_time_sec);
+	bench_metric(result, "speedup", "%lf", result -> elapsed > 0 ? naive_time_sec / result -> elapsed : 0.0);
+	bench_metric(result, "max_abs_err", "%e", max_err);
+	bench_metric(result, "rel_err", "%e", max_ref > 0 ? max_err / max_ref : 0.0);
+	return BENCH_OK;
+}
+
+static int run_recursive(const benchParams *params, benchResult *result)
+{
+	return run_recursive_common(params, result, 0);
+}
+
+static int run_strassen(const benchParams *params, benchResult *result)
+{
+	return run_recursive_common(params, result, 1);
+}
+
+static int run_outofcore(const benchParams *params, benchResult *result)
+{
+	int tile = params -> options[0] ? atoi(params -> options[0]) : DEFAULT_TILE;
+	const char *dir = params -> options[1] ? params -> options[1] : getenv("TMPDIR"); // The disk being measured.
+	char message[sizeof(result -> error)];
+	int num_threads = params -> threads;
+	unsigned long long size = params -> size;
+	double compute_time_sec = 0, write_time_sec, max_err = 0, max_ref = 0, padded;
+	struct timeval start, end, write_start;
+	oocArgs oargs[num_threads];
+	pthread_t prefetcher;
+	oocState st;
+	int fdA, fdB, fdC;
+	int i, j, k, r;
+
+	if(parse_type(params -> type) != 1 || tile <= 0)
+		return BENCH_EUSAGE;
+
+	st.tile = tile;
+	st.tiles = (size + tile - 1) / tile; // Edge tiles are zero padded.
+	st.window = num_threads + 1;
+	st.started = 0;
+	st.prefetched = 0;
+	st.ioBytes = 0;
+	st.ioTime = 0;
+
+	size_t bytes = sizeof(double) * st.tiles * st.tiles * st.tile * st.tile;
+
+	if(dir == NULL || dir[0] == '\0')
+		dir = P_tmpdir;
+
+	st.A = map_matrix_file(dir, bytes, &fdA);
+	st.B = map_matrix_file(dir, bytes, &fdB);
+	st.C = map_matrix_file(dir, bytes, &fdC);
+
+	if(st.A == NULL || st.B == NULL || st.C == NULL)
+	{
+		if(st.A != NULL) { munmap(st.A, bytes); close(fdA); }
+		if(st.B != NULL) { munmap(st.B, bytes); close(fdB); }
+		if(st.C != NULL) { munmap(st.C, bytes); close(fdC); }
+		snprintf(message, sizeof(message), "Error: unable to create or map the matrix files in %s", dir);
+		return bench_fail(result, message);
+	}
+
+	pthread_mutex_init(&st.lock, NULL);
+	pthread_cond_init(&st.cond, NULL);
+
+	for(i = 0; i < size; i++)
+	{
+		for(j = 0; j < size; j++)
+		{
+			st.A[tile_index(i, j, st.tile, st.tiles)] = rand();
+			st.B[tile_index(i, j, st.tile, st.tiles)] = rand();
+		}
+	}
+
+	evict_matrix_file(st.A, bytes, fdA);
+	evict_matrix_file(st.B, bytes, fdB);
+
+	for(i = 0; i < num_threads; i++)
+	{
+		oargs[i].state = &st;
+	}
+
+	gettimeofday(&start, NULL);
+
+	r = pthread_create(&prefetcher, NULL, prefetch_tiles, (void *) &st);
+
+	if(r == 0)
+	{
+		r = bench_threads(multiply_tiles, oargs, sizeof(oocArgs), num_threads, result);
+
+		if(r) // Compute threads missing, let the prefetcher run through without waiting on them.
+		{
+			pthread_mutex_lock(&st.lock);
+			st.started = st.tiles * st.tiles;
+			pthread_cond_broadcast(&st.cond);
+			pthread_mutex_unlock(&st.lock);
+		}
+
+		pthread_join(prefetcher, NULL);
+	}
+	else
+	{
+		bench_fail(result, "Error: unable to create one or more threads");
+	}
+
+	gettimeofday(&write_start, NULL);
+	msync(st.C, bytes, MS_SYNC); // Write the product back to its file.
+	gettimeofday(&end, NULL);
+
+	write_time_sec = bench_seconds(&write_start, &end);
+
+	for(i = 0; i < num_threads; i++)
+	{
+		compute_time_sec += oargs[i].computeTime / num_threads; // Average busy time per compute thread.
+	}
+
+	for(k = 0; k < 8 && r == 0; k++) // Spot check a few entries of C against direct dot products.
+	{
+		int ci = rand() % size, cj = rand() % size;
+		double expect = 0, diff;
+
+		for(j = 0; j < size; j++)
+		{
+			expect += st.A[tile_index(ci, j, st.tile, st.tiles)] * st.B[tile_index(j, cj, st.tile, st.tiles)];
+		}
+
+		diff = st.C[tile_index(ci, cj, st.tile, st.tiles)] - expect;
+		max_err = (diff < 0 ? -diff : diff) > max_err ? (diff < 0 ? -diff : diff) : max_err;
+		max_ref = expect > max_ref ? expect : max_ref;
+	}
+
+	munmap(st.A, bytes);
+	munmap(st.B, bytes);
+	munmap(st.C, bytes);
+	close(fdA);
+	close(fdB);
+	close(fdC);
+	pthread_mutex_destroy(&st.lock);
+	pthread_cond_destroy(&st.cond);
+
+	if(r)
+		return BENCH_EFAIL;
+
+	padded = (double) st.tiles * tile;
+	result -> elapsed = bench_seconds(&start, &end);
+	result -> gigaOps = (size * size * size) / (GIGABYTES);
+	result -> ops = 2.0 * size * size * size;
+	bench_metric(result, "tile", "%.0f", tile);
+	bench_metric(result, "compute_time", "%lf", compute_time_sec);
+	bench_metric(result, "compute_gflops", "%lf", compute_time_sec > 0 ? 2.0 * padded * padded * padded / GIGAFLOPS / compute_time_sec : 0.0);
+	bench_metric(result, "read_time", "%lf", st.ioTime);
+	bench_metric(result, "read_gib", "%lf", (double) st.ioBytes / (GIGABYTES));
+	bench_metric(result, "read_gib_per_sec", "%lf", st.ioTime > 0 ? (double) st.ioBytes / (GIGABYTES) / st.ioTime : 0.0);
+	bench_metric(result, "write_time", "%lf", write_time_sec);
+	bench_metric(result, "write_gib_per_sec", "%lf", write_time_sec > 0 ? (double) bytes / (GIGABYTES) / write_time_sec : 0.0);
+	bench_metric(result, "sample_rel_err", "%e", max_ref > 0 ? max_err / max_ref : 0.0);
+	return BENCH_OK;
+}
+
+static int run_sparse(const benchParams *params, benchResult *result)
+{
+	const char *structures[] = {"uniform", "banded", "powerlaw"};
+	double density = params -> options[0] ? atof(params -> options[0]) : DEFAULT_DENSITY;
+	int num_threads = params -> threads;
+	unsigned long long size = params -> size;
+	sparseArgs sargs[num_threads];
+	int bounds[num_threads + 1];
+	double spmv_time_sec = 0, spmm_time_sec = 0;
+	int spmv_reps, spmm_reps;
+	int structure = -1, i, k, r = 0;
+	struct timeval start, end, spmv_start;
+	double *x, *y;
+	csrMatrix csr;
+
+	for(i = 0; i < 3; i++)
+	{
+		if(strcmp(params -> type, structures[i]) == 0)
+			structure = i;
+	}
+
+	if(structure < 0 || !(density > 0 && density <= 1))
+		return BENCH_EUSAGE;
+
+	if(generate_csr(&csr, size, structure, density))
+		return bench_fail(result, "Error: too many non zeros for this size and density");
+
+	x = (double *) malloc(sizeof(double) * size * SPMM_COLS);
+	y = (double *) malloc(sizeof(double) * size * SPMM_COLS);
+
+	for(i = 0; i < size * SPMM_COLS; i++)
+	{
+		x[i] = (double) rand() / RAND_MAX;
+	}
+
+	partition_rows(&csr, num_threads, bounds);
+
+	// Repeat each product enough to do about a gigaflop, then SpMV followed by SpMM.
+	spmv_reps = (int) (GIGAFLOPS / (2.0 * csr.nnz)) + 1;
+	spmm_reps = (int) (GIGAFLOPS / (2.0 * csr.nnz * SPMM_COLS)) + 1;
+
+	for(k = 0; k < 2 && r == 0; k++)
+	{
+		for(i = 0; i < num_threads; i++)
+		{
+			sargs[i].csr = &csr;
+			sargs[i].x = x;
+			sargs[i].y = y;
+			sargs[i].rowStart = bounds[i];
+			sargs[i].rowEnd = bounds[i + 1];
+			sargs[i].cols = (k == 0) ? 1 : SPMM_COLS;
+			sargs[i].reps = (k == 0) ? spmv_reps : spmm_reps;
+		}
+
+		gettimeofday(&spmv_start, NULL);
+
+		if(k == 0)
+			start = spmv_start;
+
+		r = bench_threads((k == 0) ? spmv_csr : spmm_csr, sargs, sizeof(sparseArgs), num_threads, result);
+		gettimeofday(&end, NULL);
+
+		if(k == 0)
+			spmv_time_sec = bench_seconds(&spmv_start, &end);
+		else
+			spmm_time_sec = bench_seconds(&spmv_start, &end);
+	}
+
+	free(x);
+	free(y);
+	free_csr(&csr);
+
+	if(r)
+		return BENCH_EFAIL;
+
+	// Bytes streamed per product: values and column indices, row pointers, x once and y written.
+	double matrix_bytes = csr.nnz * (sizeof(double) + sizeof(int)) + (size + 1) * sizeof(int);
+	double spmv_bytes = matrix_bytes + 2.0 * size * sizeof(double);
+	double spmm_bytes = matrix_bytes + 2.0 * size * SPMM_COLS * sizeof(double);
+
+	result -> elapsed = bench_seconds(&start, &end);
+	result -> ops = 2.0 * csr.nnz * ((double) spmv_reps + (double) spmm_reps * SPMM_COLS);
+	result -> gigaOps = result -> ops / GIGAFLOPS;
+	bench_metric(result, "density", "%lf", density);
+	bench_metric(result, "achieved_density", "%lf", (double) csr.nnz / ((double) size * size)); // Lower: powerlaw rows clamp at n, uniform drops duplicate columns.
+	bench_metric(result, "nnz", "%.0f", csr.nnz);
+	bench_metric(result, "spmv_reps", "%.0f", spmv_reps);
+	bench_metric(result, "spmv_time", "%lf", spmv_time_sec);
+	bench_metric(result, "spmv_gflops", "%lf", 2.0 * csr.nnz * spmv_reps / GIGAFLOPS / spmv_time_sec);
+	bench_metric(result, "spmv_gb_per_sec", "%lf", spmv_bytes * spmv_reps / GIGAFLOPS / spmv_time_sec);
+	bench_metric(result, "spmm_cols", "%.0f", SPMM_COLS);
+	bench_metric(result, "spmm_reps", "%.0f", spmm_reps);
+	bench_metric(result, "spmm_time", "%lf", spmm_time_sec);
+	bench_metric(result, "spmm_gflops", "%lf", 2.0 * csr.nnz * SPMM_COLS * spmm_reps / GIGAFLOPS / spmm_time_sec);
+	bench_metric(result, "spmm_gb_per_sec", "%lf", spmm_bytes * spmm_reps / GIGAFLOPS / spmm_time_sec);
+	return BENCH_OK;
+}
+
+// Sweeps primitives, critical section lengths and thread counts, emitting and printing a row per point.
+// Per point figures only come back as rows, the result carries the totals of the whole sweep.
+static int run_sync(const benchParams *params, benchResult *result)
+{
+	const char *primitives[SYNC_PRIMITIVES + 1] = {"mutex", "spin", "ticket", "mcs", "atomic", "sharded", "all"};
+	int cs_lengths[] = {0, 10, 100, 1000};
+	int num_cs = params -> options[0] ? 1 : 4;
+	int num_threads = params -> threads;
+	int primitive = -1, first, last, i;
+	double ops_per_sec = 0, fairness = 0, min_max = 0, sync_ops = 0;
+	struct timeval start, end;
+
+	for(i = 0; i <= SYNC_PRIMITIVES; i++)
+	{
+		if(strcmp(params -> type, primitives[i]) == 0)
+			primitive = i;
+	}
+
+	if(primitive < 0 || params -> size == 0)
+		return BENCH_EUSAGE;
+
+	if(params -> options[0])
+		cs_lengths[0] = atoi(params -> options[0]);
+
+	first = (primitive == SYNC_PRIMITIVES) ? 0 : primitive;
+	last = (primitive == SYNC_PRIMITIVES) ? SYNC_PRIMITIVES - 1 : primitive;
+
+	gettimeofday(&start, NULL);
+
+	for(int p = first; p <= last; p++)
+	{
+		for(int c = 0; c < num_cs; c++)
+		{
+			for(int n = 1; ; n = (n * 2 < num_threads) ? n * 2 : num_threads) // 1, 2, 4, ... then num_threads.
+			{
+				sync_ops += sync_point(p, n, cs_lengths[c], params -> size, &ops_per_sec, &fairness, &min_max, result);
+
+				if(result -> error[0])
+					return BENCH_EFAIL;
+
+				benchRow row = {primitives[p]};
+
+				bench_row_metric(&row, "threads", "%.0f", n);
+				bench_row_metric(&row, "cs", "%.0f", cs_lengths[c]);
+				bench_row_metric(&row, "ops_per_sec", "%lf", ops_per_sec);
+				bench_row_metric(&row, "fairness", "%lf", fairness);
+				bench_row_metric(&row, "min_max", "%lf", min_max);
+				bench_emit_row(params, &row);
+
+				if(params -> out)
+					fprintf(params -> out, "primitive=%s threads=%d cs=%d ops_per_sec=%lf fairness=%lf min_max=%lf\n",primitives[p],n,cs_lengths[c],ops_per_sec,fairness,min_max);
+
+				if(n == num_threads)
+					break;
+			}
+		}
+	}
+
+	gettimeofday(&end, NULL);
+
+	result -> elapsed = bench_seconds(&start, &end);
+	result -> ops = sync_ops;
+	result -> gigaOps = sync_ops / GIGAFLOPS;
+	return BENCH_OK;
+}
+
+const benchKernel cpuKernels[] =
+{
+	{"cpu", "flops", "single / double / float", NULL, run_flops},
+	{"cpu", "matrix", "single / double / float / mixed (fp32, fp64 accumulation) / int8 / bf16 / fp16", NULL, run_matrix},
+	{"cpu", "recursive", "double", "cutoff: base case size, default 64", run_recursive},
+	{"cpu", "strassen", "double", "cutoff: base case size, default 64", run_strassen},
+	{"cpu", "outofcore", "double", "tile: tile size, default 512; dir: where the matrix files go, default $TMPDIR or /tmp", run_outofcore},
+	{"cpu", "sparse", "uniform / banded / powerlaw", "density: fraction of non zeros, default 0.01", run_sparse},
+	{"cpu", "sync", "mutex / spin / ticket / mcs / atomic / sharded / all (size: ms per point)", "cs: critical section length, default sweeps 0 / 10 / 100 / 1000", run_sync},
+	{NULL, NULL, NULL, NULL, NULL}
+};
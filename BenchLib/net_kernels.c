@@ -0,0 +1,838 @@
+/* netio kernels: local function calls, pipes, TCP/IP sockets, RPC, core-to-core latency and UDP
+ * request/response, each exposed through a run function in netKernels.
+ *
+ * Author: Grayson Kern  
+ */
+
+#define _GNU_SOURCE // CPU affinity.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/types.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sched.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <signal.h>
+#include <stdint.h>
+#include "bench.h"
+
+#define PORT 8080
+#define DEFAULT_BATCH 32
+#define DEFAULT_WINDOW 256
+#define UDP_TIMEOUT_US 10000
+#define GIGAOPS 1000000000.0
+
+static double multiply(double a, double b)
+{
+	return a * b;
+}
+
+static double divide(double a, double b)
+{
+	if(b == 0.0)
+	{
+		return 0;
+	}
+	else
+	{
+		return a / b;
+	}
+}
+
+static double add(double a, double b)
+{
+
+	return a + b;
+}
+
+static double subtract(double a, double b)
+{
+	return a - b;
+}
+
+typedef struct pingPong // State shared by the two threads of one core-to-core measurement.
+{
+	_Atomic int flag __attribute__((aligned(64))); // The bounced line, everything else starts on the next one.
+	_Atomic int stop __attribute__((aligned(64))); // Set when the measurement is abandoned.
+	int cpu[2];
+	int operation, num_ops;
+	int ping[2], pong[2]; // Read/write ends (eventfd: the same descriptor twice).
+	double elapsed_ns;
+
+}pingPong;
+
+static int pin_to_cpu(int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Gives up on a measurement: raises stop and wakes a side blocked on its descriptor.
+static void abandon(pingPong *pp)
+{
+	uint64_t token = 1;
+
+	atomic_store_explicit(&pp -> stop, 1, memory_order_release);
+
+	if(pp -> operation != 4)
+	{
+		write(pp -> ping[1], &token, sizeof(token));
+		write(pp -> pong[1], &token, sizeof(token));
+	}
+}
+
+// Bounces the flag or a message back and forth num_ops times after a short warm up.
+// Side 0 starts each round trip and times the exchange, side 1 only answers.
+static void bounce(pingPong *pp, int side)
+{
+	uint64_t token = 1;
+	struct timespec start, end;
+	int warmup = pp -> num_ops / 10;
+
+	if(pin_to_cpu(pp -> cpu[side]))
+	{
+		abandon(pp); // Unpinned numbers would be meaningless.
+		return;
+	}
+
+	for(int i = 0; i < warmup + pp -> num_ops; i++)
+	{
+		if(atomic_load_explicit(&pp -> stop, memory_order_acquire))
+			return;
+
+		if(i == warmup)
+			clock_gettime(CLOCK_MONOTONIC, &start);
+
+		if(pp -> operation == 4) // atomic: odd values are pings, even values pongs.
+		{
+			if(side == 0)
+			{
+				atomic_store_explicit(&pp -> flag, 2 * i + 1, memory_order_release);
+
+				while(atomic_load_explicit(&pp -> flag, memory_order_acquire) != 2 * i + 2)
+				{
+					if(atomic_load_explicit(&pp -> stop, memory_order_relaxed))
+						return;
+				}
+			}
+			else
+			{
+				while(atomic_load_explicit(&pp -> flag, memory_order_acquire) != 2 * i + 1)
+				{
+					if(atomic_load_explicit(&pp -> stop, memory_order_relaxed))
+						return;
+				}
+
+				atomic_store_explicit(&pp -> flag, 2 * i + 2, memory_order_release);
+			}
+		}
+		else if(side == 0) // eventfd or pipe
+		{
+			write(pp -> ping[1], &token, sizeof(token));
+			read(pp -> pong[0], &token, sizeof(token));
+		}
+		else
+		{
+			read(pp -> ping[0], &token, sizeof(token));
+			write(pp -> pong[1], &token, sizeof(token));
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if(side == 0)
+	{
+		pp -> elapsed_ns = (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+	}
+}
+
+static void *ping_thread(void *args)
+{
+	bounce((pingPong *) args, 0);
+	return NULL;
+}
+
+static void *pong_thread(void *args)
+{
+	bounce((pingPong *) args, 1);
+	return NULL;
+}
+
+// One way latency in ns between two CPUs (half the average round trip), or -1 on error.
+static double core_latency(int cpuA, int cpuB, int operation, int num_ops)
+{
+	pingPong *pp = (pingPong *) aligned_alloc(64, sizeof(pingPong));
+	pthread_t ping, pong;
+	double latency = -1;
+
+	atomic_init(&pp -> flag, 0);
+	atomic_init(&pp -> stop, 0);
+	pp -> cpu[0] = cpuA;
+	pp -> cpu[1] = cpuB;
+	pp -> operation = operation;
+	pp -> num_ops = num_ops;
+
+	pp -> ping[0] = pp -> ping[1] = pp -> pong[0] = pp -> pong[1] = -1; // pipe() leaves them alone on failure.
+
+	if(operation == 5)
+	{
+		pp -> ping[0] = pp -> ping[1] = eventfd(0, 0);
+		pp -> pong[0] = pp -> pong[1] = eventfd(0, 0);
+	}
+	else if(operation == 6)
+	{
+		pipe(pp -> ping);
+		pipe(pp -> pong);
+	}
+
+	// Without descriptors reads and writes on -1 return at once, so there is nothing to measure.
+	int ready = operation == 4 || (pp -> ping[0] != -1 && pp -> pong[0] != -1);
+
+	if(ready && pthread_create(&pong, NULL, pong_thread, (void *) pp) == 0)
+	{
+		if(pthread_create(&ping, NULL, ping_thread, (void *) pp) == 0)
+		{
+			pthread_join(ping, NULL);
+
+			if(!atomic_load_explicit(&pp -> stop, memory_order_acquire))
+				latency = pp -> elapsed_ns / num_ops / 2;
+		}
+		else
+		{
+			abandon(pp); // The pong side may be spinning, so it can't be cancelled.
+		}
+
+		pthread_join(pong, NULL);
+	}
+
+	if(operation == 5)
+	{
+		if(pp -> ping[0] != -1)
+			close(pp -> ping[0]);
+		if(pp -> pong[0] != -1)
+			close(pp -> pong[0]);
+	}
+	else if(operation == 6)
+	{
+		for(int i = 0; i < 2; i++)
+		{
+			if(pp -> ping[i] != -1)
+				close(pp -> ping[i]);
+			if(pp -> pong[i] != -1)
+				close(pp -> pong[i]);
+		}
+	}
+
+	free(pp);
+	return latency;
+}
+
+typedef struct udpMessage // One request or response datagram for the udp methods.
+{
+	uint64_t seq, sent_ns; // The server echoes both back.
+	double a, b, result;
+	int operation;
+
+}udpMessage;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static double apply_operation(int operation, double a, double b)
+{
+	switch (operation)
+	{
+		case 0:
+			return add(a, b);
+		case 1:
+			return subtract(a, b);
+		case 2:
+			return multiply(a, b);
+		default:
+			return divide(a, b);
+	}
+}
+
+static int compare_double(const void *a, const void *b)
+{
+	return (*(const double *) a > *(const double *) b) - (*(const double *) a < *(const double *) b);
+}
+
+// Points each header at its own message buffer (and source address, when given).
+static void setup_mmsg(struct mmsghdr *hdrs, struct iovec *iov, udpMessage *msgs, struct sockaddr_in *from, int batch)
+{
+	memset(hdrs, 0, sizeof(struct mmsghdr) * batch);
+
+	for(int i = 0; i < batch; i++)
+	{
+		iov[i].iov_base = &msgs[i];
+		iov[i].iov_len = sizeof(udpMessage);
+		hdrs[i].msg_hdr.msg_iov = &iov[i];
+		hdrs[i].msg_hdr.msg_iovlen = 1;
+
+		if(from != NULL)
+		{
+			hdrs[i].msg_hdr.msg_name = &from[i];
+			hdrs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		}
+	}
+}
+
+// sendmmsg until all n datagrams are out, it may send fewer than asked.
+// Returns how many were sent, short only if the socket reports a real error.
+static int send_mmsg(int sock, struct mmsghdr *hdrs, int n)
+{
+	int sent = 0, r;
+
+	while(sent < n)
+	{
+		r = sendmmsg(sock, hdrs + sent, n - sent, 0);
+
+		if(r < 0 && (errno == EINTR || errno == EAGAIN || errno == ENOBUFS))
+			continue;
+
+		if(r <= 0)
+			break;
+
+		sent += r;
+	}
+
+	return sent;
+}
+
+// Server side (forked child): answers each request with the result of its operation until killed.
+// With batch > 1 requests are drained and answered batch at a time with recvmmsg/sendmmsg.
+static void udp_server(int sock, int batch)
+{
+	udpMessage msgs[batch];
+	struct mmsghdr hdrs[batch];
+	struct iovec iov[batch];
+	struct sockaddr_in from[batch];
+	socklen_t fromLen;
+	int n;
+
+	setup_mmsg(hdrs, iov, msgs, from, batch);
+
+	for(;;)
+	{
+		if(batch > 1)
+		{
+			for(int i = 0; i < batch; i++)
+				hdrs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+
+			n = recvmmsg(sock, hdrs, batch, MSG_WAITFORONE, NULL);
+		}
+		else
+		{
+			fromLen = sizeof(from[0]);
+			n = recvfrom(sock, &msgs[0], sizeof(udpMessage), 0, (struct sockaddr *) &from[0], &fromLen) > 0;
+		}
+
+		if(n <= 0)
+			continue;
+
+		for(int i = 0; i < n; i++)
+			msgs[i].result = apply_operation(msgs[i].operation, msgs[i].a, msgs[i].b);
+
+		if(batch > 1)
+			send_mmsg(sock, hdrs, n);
+		else
+			sendto(sock, &msgs[0], sizeof(udpMessage), 0, (struct sockaddr *) &from[0], fromLen);
+	}
+}
+
+typedef struct udpTally // What the udp client saw.
+{
+	int sent, received;
+	int stalls; // Times the whole window was lost mid run and the client sat out a timeout.
+	struct timeval lastAnswer;
+
+}udpTally;
+
+// Client side: keeps up to window requests outstanding, sending them batch at a time, and takes answers
+// as they come, late ones included (each seq is counted once). Only when nothing more may be sent does it
+// block, for at most the receive timeout; if that runs out, whatever is in flight is written off.
+// Round trip latencies (ns) of the answers go into latency in arrival order.
+static void udp_client(int sock, int operation, int num_ops, int batch, int window, double *latency, udpTally *tally)
+{
+	udpMessage sendMsgs[batch], recvMsgs[batch];
+	struct mmsghdr sendHdrs[batch], recvHdrs[batch];
+	struct iovec sendIov[batch], recvIov[batch];
+	char *answered = (char *) calloc(num_ops > 0 ? num_ops : 1, 1);
+	int next = 0, inflight = 0;
+
+	memset(tally, 0, sizeof(udpTally));
+	gettimeofday(&tally -> lastAnswer, NULL);
+	setup_mmsg(sendHdrs, sendIov, sendMsgs, NULL, batch);
+	setup_mmsg(recvHdrs, recvIov, recvMsgs, NULL, batch);
+
+	while(next < num_ops || inflight > 0)
+	{
+		int n = (num_ops - next < batch) ? num_ops - next : batch;
+		int flags, r;
+
+		if(n > window - inflight)
+			n = window - inflight;
+
+		if(n > 0)
+		{
+			for(int i = 0; i < n; i++)
+			{
+				sendMsgs[i].seq = next + i;
+				sendMsgs[i].operation = operation;
+				sendMsgs[i].a = (double)rand()/RAND_MAX;
+				sendMsgs[i].b = (double)rand()/RAND_MAX;
+				sendMsgs[i].sent_ns = now_ns();
+			}
+
+			if(batch > 1)
+				r = send_mmsg(sock, sendHdrs, n);
+			else
+				r = send(sock, &sendMsgs[0], sizeof(udpMessage), 0) > 0;
+
+			next += n; // Requests the socket refused are skipped, not counted as sent.
+			inflight += r;
+			tally -> sent += r;
+		}
+
+		flags = (next < num_ops && inflight < window) ? MSG_DONTWAIT : 0; // Only block when there's nothing to send.
+
+		if(batch > 1)
+			r = recvmmsg(sock, recvHdrs, batch, flags | MSG_WAITFORONE, NULL);
+		else
+			r = recv(sock, &recvMsgs[0], sizeof(udpMessage), flags) > 0;
+
+		if(r <= 0)
+		{
+			if(flags == 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) // Timed out, the window was dropped.
+			{
+				tally -> stalls += (next < num_ops);
+				inflight = 0;
+			}
+
+			continue;
+		}
+
+		uint64_t now = now_ns();
+
+		for(int i = 0; i < r; i++)
+		{
+			uint64_t seq = recvMsgs[i].seq;
+
+			if(seq < (uint64_t) num_ops && !answered[seq])
+			{
+				answered[seq] = 1;
+				latency[tally -> received++] = (double) (now - recvMsgs[i].sent_ns);
+				inflight -= (inflight > 0);
+			}
+		}
+
+		gettimeofday(&tally -> lastAnswer, NULL);
+	}
+
+	free(answered);
+}
+
+
+// Index of a netio operation name (add, subtract, multiply, divide, atomic, eventfd, pipe), -1 if unknown.
+static int parse_operation(const char *name)
+{
+	const char *operations[] = {"add", "subtract", "multiply", "divide", "atomic", "eventfd", "pipe"};
+	int i;
+
+	for(i = 0; i < 7; i++)
+	{
+		if(strcmp(name, operations[i]) == 0)
+			return i;
+	}
+
+	return -1;
+}
+
+// Fills in the timing and the operation count shared by every netio kernel. Callers take end
+// as soon as the measured work is over, before any sorting or printing.
+static int net_done(benchResult *result, const struct timeval *start, const struct timeval *end, double total_ops)
+{
+	result -> elapsed = bench_seconds(start, end);
+	result -> ops = total_ops;
+	result -> gigaOps = total_ops / GIGAOPS;
+	return BENCH_OK;
+}
+
+static int run_function(const benchParams *params, benchResult *result)
+{
+	int operation = parse_operation(params -> type);
+	int num_ops = params -> size;
+	volatile double ret_value = 0.0; // Keeps the calls from being optimized away.
+	struct timeval start, end;
+
+	gettimeofday(&start, NULL);
+
+	switch (operation)
+	{
+		case 0: // add
+			for (int i=0;i<num_ops;i++)
+				ret_value = add((double)rand()/RAND_MAX,(double)rand()/RAND_MAX);
+			break;
+
+		case 1: // subtract
+			for (int i=0;i<num_ops;i++)
+				ret_value = subtract((double)rand()/RAND_MAX,(double)rand()/RAND_MAX);
+			break;
+
+		case 2: // multiply
+			for (int i=0;i<num_ops;i++)
+				ret_value = multiply((double)rand()/RAND_MAX,(double)rand()/RAND_MAX);
+			break;
+
+		case 3: // divide
+			for (int i=0;i<num_ops;i++)
+				ret_value = divide((double)rand()/RAND_MAX,(double)rand()/RAND_MAX);
+			break;
+
+		default:
+			return BENCH_EUSAGE;
+	}
+
+	(void) ret_value;
+	gettimeofday(&end, NULL);
+	return net_done(result, &start, &end, num_ops);
+}
+
+static int run_pipe(const benchParams *params, benchResult *result)
+{
+	int operation = parse_operation(params -> type);
+	int num_ops = params -> size;
+	double ret_value = 0.0;
+	struct timeval start, end;
+	int fds[2];
+	pid_t pid;
+
+	if(operation < 0 || operation > 3)
+		return BENCH_EUSAGE;
+
+	gettimeofday(&start, NULL);
+
+	if(pipe(fds) == -1)
+		return bench_fail(result, "unable to create pipe, exit...");
+
+	if((pid = fork()) == 0) // Child writes 
+	{
+		for(int i = 1; i <= num_ops; i++)
+		{
+			ret_value = apply_operation(operation, (double)rand()/RAND_MAX, (double)rand()/RAND_MAX);
+			write(fds[1], &ret_value, sizeof(ret_value));
+		}
+
+		_exit(0); // Not exit(), the caller's stdio buffers belong to the parent.
+	}
+	else // Parent reads
+	{
+		for(int i = 1; i <= num_ops && pid > 0; i++)
+		{
+			read(fds[0], &ret_value, sizeof(ret_value));
+		}
+	}
+
+	close(fds[0]);
+	close(fds[1]);
+
+	if(pid < 0)
+		return bench_fail(result, "unable to fork, exit...");
+
+	waitpid(pid, NULL, 0);
+	gettimeofday(&end, NULL);
+	return net_done(result, &start, &end, num_ops);
+}
+
+static int run_socket(const benchParams *params, benchResult *result)
+{
+	int operation = parse_operation(params -> type);
+	int num_ops = params -> size;
+	int client = socket(PF_INET, SOCK_STREAM, 0);
+	int server = socket(PF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in socketAddress;
+	socklen_t socketAddressLen = sizeof(socketAddress);
+	double ret_value = 0.0;
+	struct timeval start, end;
+
+	if(operation < 0 || operation > 3)
+	{
+		close(client);
+		close(server);
+		return BENCH_EUSAGE;
+	}
+
+	memset(&socketAddress, 0, sizeof(socketAddress));
+	socketAddress.sin_family = AF_INET;
+	socketAddress.sin_port = htons(PORT);
+	socketAddress.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	gettimeofday(&start, NULL);
+
+	if(bind(server, (struct sockaddr *) &socketAddress, sizeof(socketAddress)) != -1) // Bind address structure to server
+	{
+		listen(server, 1); // Listen for a connection
+
+		if(connect(server, (struct sockaddr *) &socketAddress, sizeof(socketAddress)) != -1) // If a connection exists, connect.
+		{
+			for(int i = 1; i <= num_ops; i++) // Perform calculations.
+			{
+				ret_value = apply_operation(operation, (double)rand()/RAND_MAX, (double)rand()/RAND_MAX);
+				send(server, &ret_value, sizeof(ret_value), 0);
+				accept(client, (struct sockaddr *) &socketAddress, &socketAddressLen);
+				recv(client, &ret_value, sizeof(ret_value), 0);
+				send(client, &ret_value, sizeof(ret_value), 0);
+			}
+		}
+	}
+
+	close(client);
+	close(server);
+	gettimeofday(&end, NULL);
+	return net_done(result, &start, &end, num_ops);
+}
+
+static int run_rpc(const benchParams *params, benchResult *result)
+{
+	int operation = parse_operation(params -> type);
+	struct timeval start, end;
+
+	if(operation < 0 || operation > 3)
+		return BENCH_EUSAGE;
+
+	gettimeofday(&start, NULL);
+
+	if(params -> out)
+		fprintf(params -> out, "rpc %s %llu\n", params -> type, params -> size);
+
+	gettimeofday(&end, NULL);
+	return net_done(result, &start, &end, params -> size);
+}
+
+// Ping-pong between every pair of CPUs we may run on, one row per pair and printed as a matrix of one way latencies in ns.
+static int run_cores(const benchParams *params, benchResult *result)
+{
+	int operation = parse_operation(params -> type);
+	int num_ops = params -> size;
+	FILE *out = params -> out;
+	cpu_set_t allowed;
+	int cpus[CPU_SETSIZE], num_cpus = 0;
+	double min_ns = 0, max_ns = 0, sum_ns = 0;
+	int measured = 0;
+	struct timeval start, end;
+
+	if(operation < 4 || num_ops < 1) // Each pair needs at least one timed round trip.
+		return BENCH_EUSAGE;
+
+	gettimeofday(&start, NULL);
+	sched_getaffinity(0, sizeof(allowed), &allowed);
+
+	for(int c = 0; c < CPU_SETSIZE; c++)
+	{
+		if(CPU_ISSET(c, &allowed))
+			cpus[num_cpus++] = c;
+	}
+
+	double *latency = (double *) calloc((size_t) num_cpus * num_cpus, sizeof(double));
+
+	for(int a = 0; a < num_cpus; a++)
+	{
+		for(int b = a + 1; b < num_cpus; b++) // Latency is symmetric, measure each pair once.
+		{
+			double ns = core_latency(cpus[a], cpus[b], operation, num_ops);
+
+			latency[a * num_cpus + b] = ns;
+			latency[b * num_cpus + a] = ns;
+
+			benchRow row = {NULL};
+
+			bench_row_metric(&row, "cpu_a", "%.0f", cpus[a]);
+			bench_row_metric(&row, "cpu_b", "%.0f", cpus[b]);
+			bench_row_metric(&row, "latency_ns", "%.1f", ns);
+			bench_emit_row(params, &row);
+
+
+			if(ns >= 0) // -1: the pair could not be pinned or measured.
+			{
+				min_ns = (measured == 0 || ns < min_ns) ? ns : min_ns;
+				max_ns = ns > max_ns ? ns : max_ns;
+				sum_ns += ns;
+				measured++;
+			}
+		}
+	}
+
+	gettimeofday(&end, NULL);
+
+	if(out)
+	{
+		fprintf(out, "%6s", "cpu");
+
+		for(int b = 0; b < num_cpus; b++)
+			fprintf(out, " %8d", cpus[b]);
+
+		fprintf(out, "\n");
+
+		for(int a = 0; a < num_cpus; a++)
+		{
+			fprintf(out, "%6d", cpus[a]);
+
+			for(int b = 0; b < num_cpus; b++)
+			{
+				if(a == b)
+					fprintf(out, " %8s", "-");
+				else
+					fprintf(out, " %8.1f", latency[a * num_cpus + b]);
+			}
+
+			fprintf(out, "\n");
+		}
+	}
+
+	free(latency);
+	bench_metric(result, "cpus", "%.0f", num_cpus);
+	bench_metric(result, "min_ns", "%.1f", min_ns);
+	bench_metric(result, "mean_ns", "%.1f", measured > 0 ? sum_ns / measured : 0.0);
+	bench_metric(result, "max_ns", "%.1f", max_ns);
+	return net_done(result, &start, &end, (double) num_ops * num_cpus * (num_cpus - 1) / 2); // Round trips.
+}
+
+// Requests to a forked server over loopback UDP, one datagram per call or batch at a time.
+static int run_udp_common(const benchParams *params, benchResult *result, int mmsg)
+{
+	int operation = parse_operation(params -> type);
+	int num_ops = params -> size;
+	int batch = mmsg ? (params -> options[0] ? atoi(params -> options[0]) : DEFAULT_BATCH) : 1;
+	const char *rcvbufOption = params -> options[mmsg ? 1 : 0]; // udp has no batch argument.
+	const char *windowOption = params -> options[mmsg ? 2 : 1];
+	int rcvbuf = rcvbufOption ? atoi(rcvbufOption) : 0;
+	int window = windowOption ? atoi(windowOption) : DEFAULT_WINDOW;
+	udpTally tally;
+	struct sockaddr_in udpAddress;
+	socklen_t udpAddressLen = sizeof(udpAddress);
+	struct timeval timeout = {0, UDP_TIMEOUT_US};
+	struct timeval start, end, clientEnd;
+	int udpServer, udpClient;
+	pid_t pid;
+
+	if(operation < 0 || operation > 3)
+		return BENCH_EUSAGE;
+
+	if(batch < 1 || batch > UIO_MAXIOV) // The kernel caps sendmmsg / recvmmsg at UIO_MAXIOV messages.
+		return bench_fail(result, "batch size must be between 1 and 1024 (UIO_MAXIOV), exit...");
+
+	if(window < 1)
+		return bench_fail(result, "window must be positive, exit...");
+
+	udpServer = socket(AF_INET, SOCK_DGRAM, 0);
+	udpClient = socket(AF_INET, SOCK_DGRAM, 0);
+
+	memset(&udpAddress, 0, sizeof(udpAddress));
+	udpAddress.sin_family = AF_INET;
+	udpAddress.sin_port = 0; // Let the kernel pick a free port.
+	udpAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if(rcvbuf > 0)
+	{
+		setsockopt(udpServer, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+		setsockopt(udpClient, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+	}
+
+	if(bind(udpServer, (struct sockaddr *) &udpAddress, sizeof(udpAddress)) == -1 ||
+		getsockname(udpServer, (struct sockaddr *) &udpAddress, &udpAddressLen) == -1 ||
+		connect(udpClient, (struct sockaddr *) &udpAddress, sizeof(udpAddress)) == -1 ||
+		(pid = fork()) < 0)
+	{
+		close(udpServer);
+		close(udpClient);
+		return bench_fail(result, "unable to set up udp sockets, exit...");
+	}
+
+	if(pid == 0) // Child serves.
+	{
+		close(udpClient);
+		udp_server(udpServer, batch);
+		_exit(0);
+	}
+
+	close(udpServer);
+	setsockopt(udpClient, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+	double *latency = (double *) malloc(sizeof(double) * (num_ops > 0 ? num_ops : 1));
+
+	gettimeofday(&start, NULL);
+	udp_client(udpClient, operation, num_ops, batch, window, latency, &tally);
+	gettimeofday(&clientEnd, NULL);
+
+	// ops/sec runs to the last answer, the wait for stragglers that never came is reported on its own.
+	int answered = tally.received, sent = tally.sent;
+	end = answered > 0 ? tally.lastAnswer : clientEnd;
+
+	kill(pid, SIGTERM);
+	waitpid(pid, NULL, 0);
+	close(udpClient);
+
+	qsort(latency, answered, sizeof(double), compare_double);
+
+	bench_metric(result, "batch", "%.0f", batch);
+	bench_metric(result, "window", "%.0f", window);
+	bench_metric(result, "sent", "%.0f", sent);
+	bench_metric(result, "received", "%.0f", answered);
+	bench_metric(result, "loss_pct", "%.4f", sent > 0 ? 100.0 * (sent - answered) / sent : 0.0);
+	bench_metric(result, "stalls", "%.0f", tally.stalls);
+	bench_metric(result, "final_wait", "%lf", bench_seconds(&end, &clientEnd));
+
+	if(answered > 0)
+	{
+		bench_metric(result, "p50_us", "%.1f", latency[(int) (answered * 0.50)] / 1000);
+		bench_metric(result, "p90_us", "%.1f", latency[(int) (answered * 0.90)] / 1000);
+		bench_metric(result, "p99_us", "%.1f", latency[(int) (answered * 0.99)] / 1000);
+		bench_metric(result, "p999_us", "%.1f", latency[(int) (answered * 0.999)] / 1000);
+		bench_metric(result, "max_us", "%.1f", latency[answered - 1] / 1000);
+	}
+
+	free(latency);
+	return net_done(result, &start, &end, answered);
+}
+
+static int run_udp(const benchParams *params, benchResult *result)
+{
+	return run_udp_common(params, result, 0);
+}
+
+static int run_udpmmsg(const benchParams *params, benchResult *result)
+{
+	return run_udp_common(params, result, 1);
+}
+
+const benchKernel netKernels[] =
+{
+	{"net", "function", "add / subtract / multiply / divide", NULL, run_function},
+	{"net", "pipe", "add / subtract / multiply / divide", NULL, run_pipe},
+	{"net", "socket", "add / subtract / multiply / divide", NULL, run_socket},
+	{"net", "rpc", "add / subtract / multiply / divide", NULL, run_rpc},
+	{"net", "cores", "atomic / eventfd / pipe", NULL, run_cores},
+	{"net", "udp", "add / subtract / multiply / divide", "rcvbuf: SO_RCVBUF in bytes, default system; window: requests outstanding, default 256", run_udp},
+	{"net", "udpmmsg", "add / subtract / multiply / divide", "batch: datagrams per sendmmsg/recvmmsg, 1 - 1024, default 32; rcvbuf: SO_RCVBUF in bytes, default system; window: requests outstanding, default 256", run_udpmmsg},
+	{NULL, NULL, NULL, NULL, NULL}
+};